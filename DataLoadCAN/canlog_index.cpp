@@ -0,0 +1,140 @@
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <algorithm>
+
+#include "canlog_index.h"
+
+namespace
+{
+const quint32 INDEX_MAGIC = 0x504A4349;  // "PJCI"
+const quint32 INDEX_VERSION = 1;
+
+// Lines of candump -L start with "(<seconds>.<fraction>)"
+bool parseTimestamp(const QByteArray& line, double& timestamp)
+{
+  if (!line.startsWith('('))
+  {
+    return false;
+  }
+  const int close = line.indexOf(')');
+  if (close < 0)
+  {
+    return false;
+  }
+  bool ok = false;
+  // QByteArray::toDouble is locale independent
+  timestamp = line.mid(1, close - 1).toDouble(&ok);
+  return ok;
+}
+}  // namespace
+
+bool CanLogIndex::load(const QFile& log_file)
+{
+  const QFileInfo log_info(log_file.fileName());
+  QFile index_file(indexFilename(log_file.fileName()));
+  if (!index_file.open(QFile::ReadOnly))
+  {
+    return false;
+  }
+  QDataStream in(&index_file);
+  quint32 magic, version;
+  qint64 log_size, log_mtime;
+  quint64 entry_count;
+  in >> magic >> version >> log_size >> log_mtime;
+  if (magic != INDEX_MAGIC || version != INDEX_VERSION || log_size != log_info.size() ||
+      log_mtime != log_info.lastModified().toMSecsSinceEpoch())
+  {
+    return false;
+  }
+  in >> stride_ >> line_count_ >> first_timestamp_ >> last_timestamp_ >> entry_count;
+  entries_.resize(entry_count);
+  for (auto& entry : entries_)
+  {
+    in >> entry.offset >> entry.timestamp;
+  }
+  return in.status() == QDataStream::Ok;
+}
+
+void CanLogIndex::build(QFile& log_file, quint32 stride)
+{
+  stride_ = stride;
+  line_count_ = 0;
+  entries_.clear();
+  bool has_timestamp = false;
+
+  log_file.seek(0);
+  while (!log_file.atEnd())
+  {
+    const qint64 offset = log_file.pos();
+    const QByteArray line = log_file.readLine();
+    double timestamp;
+    // Only the indexed lines are parsed, besides the first and the last one
+    const bool indexed = line_count_ % stride_ == 0;
+    if ((indexed || !has_timestamp || log_file.atEnd()) && parseTimestamp(line, timestamp))
+    {
+      if (!has_timestamp)
+      {
+        first_timestamp_ = timestamp;
+        has_timestamp = true;
+      }
+      if (indexed)
+      {
+        entries_.push_back({ offset, timestamp });
+      }
+      last_timestamp_ = timestamp;
+    }
+    line_count_++;
+  }
+  log_file.seek(0);
+}
+
+bool CanLogIndex::save(const QFile& log_file) const
+{
+  const QFileInfo log_info(log_file.fileName());
+  QFile index_file(indexFilename(log_file.fileName()));
+  if (!index_file.open(QFile::WriteOnly | QFile::Truncate))
+  {
+    // Read only location, the index is rebuilt on the next load
+    return false;
+  }
+  QDataStream out(&index_file);
+  out << INDEX_MAGIC << INDEX_VERSION << qint64(log_info.size())
+      << qint64(log_info.lastModified().toMSecsSinceEpoch());
+  out << stride_ << line_count_ << first_timestamp_ << last_timestamp_ << quint64(entries_.size());
+  for (const auto& entry : entries_)
+  {
+    out << entry.offset << entry.timestamp;
+  }
+  return out.status() == QDataStream::Ok;
+}
+
+std::vector<CanLogIndex::Entry>::const_iterator CanLogIndex::entryBefore(double timestamp) const
+{
+  auto it = std::upper_bound(entries_.begin(), entries_.end(), timestamp,
+                             [](double ts, const Entry& entry) { return ts < entry.timestamp; });
+  // Step back one more entry, so that slightly unordered timestamps are not skipped
+  for (int i = 0; i < 2 && it != entries_.begin(); i++)
+  {
+    --it;
+  }
+  return it;
+}
+
+qint64 CanLogIndex::seekOffset(double timestamp) const
+{
+  auto it = entryBefore(timestamp);
+  return it != entries_.end() ? it->offset : 0;
+}
+
+qint64 CanLogIndex::estimateLines(double start, double end) const
+{
+  auto first = entryBefore(start);
+  auto last = std::upper_bound(entries_.begin(), entries_.end(), end,
+                               [](double ts, const Entry& entry) { return ts < entry.timestamp; });
+  if (last == entries_.end())
+  {
+    return line_count_ - std::distance(entries_.begin(), first) * qint64(stride_);
+  }
+  return std::distance(first, last) * qint64(stride_);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <vector>
+
+// Sparse index of a candump log: the byte offset and timestamp of every stride-th line.
+// It is stored next to the log (<log>.pjidx) so that it is built only once, and allows
+// seeking to a time window without parsing the lines before it.
+class CanLogIndex
+{
+public:
+  struct Entry
+  {
+    qint64 offset;
+    double timestamp;
+  };
+  static const quint32 DEFAULT_STRIDE = 1024;
+
+  // Load the stored index, fails if it is missing or older than the log
+  bool load(const QFile& log_file);
+  // Index the log in a single pass over its lines
+  void build(QFile& log_file, quint32 stride = DEFAULT_STRIDE);
+  bool save(const QFile& log_file) const;
+
+  qint64 lineCount() const
+  {
+    return line_count_;
+  }
+  double firstTimestamp() const
+  {
+    return first_timestamp_;
+  }
+  double lastTimestamp() const
+  {
+    return last_timestamp_;
+  }
+  // Offset of an indexed line from which every frame at or after timestamp is reached
+  qint64 seekOffset(double timestamp) const;
+  // Upper bound of the number of lines between two timestamps
+  qint64 estimateLines(double start, double end) const;
+
+  static QString indexFilename(const QString& log_filename)
+  {
+    return log_filename + ".pjidx";
+  }
+
+private:
+  std::vector<Entry>::const_iterator entryBefore(double timestamp) const;
+
+  quint32 stride_ = DEFAULT_STRIDE;
+  qint64 line_count_ = 0;
+  double first_timestamp_ = 0.0;
+  double last_timestamp_ = 0.0;
+  std::vector<Entry> entries_;
+};
@@ -0,0 +1,443 @@
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#include "compressed_log.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+namespace
+{
+#ifdef HAVE_ZSTD
+// Frames up to this size are decompressed in parallel, each in one piece
+const unsigned long long MAX_PARALLEL_FRAME_SIZE = 64 << 20;
+
+struct ZstdFrame
+{
+  size_t offset;
+  size_t size;
+  unsigned long long content_size;
+};
+
+// Decompresses a frame whose content size is known, false if it is corrupted
+bool decompressZstdFrame(const uint8_t* data, const ZstdFrame& frame, QByteArray& output)
+{
+  output.resize(int(frame.content_size));
+  const size_t result = ZSTD_decompress(output.data(), output.size(), data + frame.offset, frame.size);
+  return !ZSTD_isError(result) && result == frame.content_size;
+}
+#endif
+}  // namespace
+
+CompressedLogReader::Format CompressedLogReader::formatOf(const QString& filename)
+{
+  if (filename.endsWith(".gz"))
+  {
+    return GZIP;
+  }
+  if (filename.endsWith(".zst"))
+  {
+    return ZSTD;
+  }
+  if (filename.endsWith(".xz"))
+  {
+    return XZ;
+  }
+  return NONE;
+}
+
+bool CompressedLogReader::isSupported(Format format)
+{
+  switch (format)
+  {
+#ifdef HAVE_ZLIB
+    case GZIP:
+      return true;
+#endif
+#ifdef HAVE_ZSTD
+    case ZSTD:
+      return true;
+#endif
+#ifdef HAVE_LZMA
+    case XZ:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+std::vector<const char*> CompressedLogReader::supportedExtensions()
+{
+  std::vector<const char*> extensions;
+  if (isSupported(GZIP))
+  {
+    extensions.push_back("gz");
+  }
+  if (isSupported(ZSTD))
+  {
+    extensions.push_back("zst");
+  }
+  if (isSupported(XZ))
+  {
+    extensions.push_back("xz");
+  }
+  return extensions;
+}
+
+CompressedLogReader::~CompressedLogReader()
+{
+  close();
+}
+
+bool CompressedLogReader::open(const QString& filename, QString* error_string)
+{
+  close();
+  format_ = formatOf(filename);
+  if (!isSupported(format_))
+  {
+    *error_string = QObject::tr("%1 is compressed in a format this build cannot read").arg(filename);
+    return false;
+  }
+  file_.setFileName(filename);
+  if (!file_.open(QFile::ReadOnly))
+  {
+    *error_string = file_.errorString();
+    return false;
+  }
+  size_ = file_.size();
+  data_ = file_.map(0, size_);
+  if (size_ > 0 && !data_)
+  {
+    *error_string = QObject::tr("Could not map %1 into memory").arg(filename);
+    file_.close();
+    return false;
+  }
+  thread_ = std::thread([this]() { decompress(); });
+  return true;
+}
+
+void CompressedLogReader::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  queue_changed_.notify_all();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+  if (file_.isOpen())
+  {
+    file_.close();
+  }
+  data_ = nullptr;
+  size_ = 0;
+  consumed_ = 0;
+  blocks_.clear();
+  remainder_.clear();
+  finished_ = false;
+  closing_ = false;
+  error_.clear();
+}
+
+QString CompressedLogReader::errorString() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return error_;
+}
+
+bool CompressedLogReader::nextBlock(QByteArray& block)
+{
+  while (true)
+  {
+    QByteArray data;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_changed_.wait(lock, [this]() { return !blocks_.empty() || finished_; });
+      if (blocks_.empty())
+      {
+        // A last line without line feed
+        block = remainder_;
+        remainder_.clear();
+        return !block.isEmpty();
+      }
+      data = std::move(blocks_.front());
+      blocks_.pop_front();
+    }
+    queue_changed_.notify_all();
+
+    const int line_end = data.lastIndexOf('\n') + 1;
+    if (line_end == 0)
+    {
+      remainder_ += data;
+      continue;
+    }
+    block = remainder_.isEmpty() ? data.left(line_end) : remainder_ + data.left(line_end);
+    remainder_ = data.mid(line_end);
+    return true;
+  }
+}
+
+bool CompressedLogReader::pushBlock(QByteArray block)
+{
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_changed_.wait(lock, [this]() { return blocks_.size() < MAX_QUEUED_BLOCKS || closing_; });
+    if (closing_)
+    {
+      return false;
+    }
+    blocks_.push_back(std::move(block));
+  }
+  queue_changed_.notify_all();
+  return true;
+}
+
+void CompressedLogReader::setError(const QString& error)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  error_ = error;
+}
+
+void CompressedLogReader::decompress()
+{
+  switch (format_)
+  {
+    case GZIP:
+      decompressGzip();
+      break;
+    case ZSTD:
+      decompressZstd();
+      break;
+    case XZ:
+      decompressXz();
+      break;
+    default:
+      break;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  queue_changed_.notify_all();
+}
+
+bool CompressedLogReader::decompressGzip()
+{
+#ifdef HAVE_ZLIB
+  z_stream stream = {};
+  // 32 enables gzip header detection
+  if (inflateInit2(&stream, 15 + 32) != Z_OK)
+  {
+    setError(QObject::tr("Cannot initialize zlib"));
+    return false;
+  }
+  // avail_in is 32 bits wide, large files are fed in pieces
+  const size_t MAX_INPUT_CHUNK = 1 << 30;
+  size_t input_pos = 0;
+  bool ok = true;
+  while (ok)
+  {
+    if (stream.avail_in == 0 && input_pos < size_t(size_))
+    {
+      const size_t input_len = std::min(size_t(size_) - input_pos, MAX_INPUT_CHUNK);
+      stream.next_in = const_cast<Bytef*>(data_ + input_pos);
+      stream.avail_in = uInt(input_len);
+      input_pos += input_len;
+    }
+    QByteArray output(BLOCK_SIZE, Qt::Uninitialized);
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = BLOCK_SIZE;
+    const int ret = inflate(&stream, Z_NO_FLUSH);
+    consumed_ = qint64(input_pos - stream.avail_in);
+    const bool input_done = stream.avail_in == 0 && input_pos == size_t(size_);
+    if (ret != Z_OK && ret != Z_STREAM_END && !(ret == Z_BUF_ERROR && !input_done))
+    {
+      setError(QObject::tr("Corrupted or truncated gzip data"));
+      ok = false;
+    }
+    output.resize(BLOCK_SIZE - int(stream.avail_out));
+    if (!output.isEmpty() && !pushBlock(std::move(output)))
+    {
+      break;
+    }
+    if (ret == Z_STREAM_END)
+    {
+      if (input_done)
+      {
+        break;
+      }
+      // Concatenated gzip members, as written by pigz or cat
+      inflateReset(&stream);
+    }
+  }
+  inflateEnd(&stream);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+bool CompressedLogReader::decompressXz()
+{
+#ifdef HAVE_LZMA
+  lzma_stream stream = LZMA_STREAM_INIT;
+  if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+  {
+    setError(QObject::tr("Cannot initialize liblzma"));
+    return false;
+  }
+  stream.next_in = data_;
+  stream.avail_in = size_t(size_);
+  bool ok = true;
+  while (true)
+  {
+    QByteArray output(BLOCK_SIZE, Qt::Uninitialized);
+    stream.next_out = reinterpret_cast<uint8_t*>(output.data());
+    stream.avail_out = BLOCK_SIZE;
+    // The whole input is available, so the decoder is told to finish right away
+    const lzma_ret ret = lzma_code(&stream, LZMA_FINISH);
+    consumed_ = qint64(stream.total_in);
+    if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+    {
+      setError(QObject::tr("Corrupted or truncated xz data"));
+      ok = false;
+    }
+    output.resize(BLOCK_SIZE - int(stream.avail_out));
+    if ((!output.isEmpty() && !pushBlock(std::move(output))) || ret != LZMA_OK)
+    {
+      break;
+    }
+  }
+  lzma_end(&stream);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+bool CompressedLogReader::decompressZstd()
+{
+#ifdef HAVE_ZSTD
+  std::vector<ZstdFrame> frames;
+  bool parallel = true;
+  for (size_t offset = 0; offset < size_t(size_);)
+  {
+    const size_t frame_size = ZSTD_findFrameCompressedSize(data_ + offset, size_t(size_) - offset);
+    if (ZSTD_isError(frame_size))
+    {
+      setError(QObject::tr("Corrupted or truncated zstd data"));
+      return false;
+    }
+    const unsigned long long content_size = ZSTD_getFrameContentSize(data_ + offset, frame_size);
+    // Skippable frames, like the seek table, have no content
+    if (content_size != 0)
+    {
+      frames.push_back({ offset, frame_size, content_size });
+    }
+    // Frames without content size, or too large ones, are left to the streaming decoder
+    parallel = parallel && content_size <= MAX_PARALLEL_FRAME_SIZE;
+    offset += frame_size;
+  }
+  if (!parallel || frames.size() < 2)
+  {
+    return decompressZstdStream();
+  }
+
+  // Frames are independent: a window of them is decompressed on the thread pool, and handed to the
+  // parser in file order
+  const size_t window = size_t(std::max(2, QThread::idealThreadCount()));
+  std::deque<std::pair<QFuture<bool>, QByteArray*>> in_flight;
+  std::deque<QByteArray> outputs;
+  bool ok = true;
+  size_t next = 0;
+  size_t done = 0;
+  while (ok && done < frames.size())
+  {
+    while (next < frames.size() && in_flight.size() < window)
+    {
+      outputs.emplace_back();
+      QByteArray* output = &outputs.back();
+      const ZstdFrame frame = frames[next++];
+      const uint8_t* data = data_;
+      in_flight.emplace_back(QtConcurrent::run([data, frame, output]() { return decompressZstdFrame(data, frame, *output); }),
+                             output);
+    }
+    ok = in_flight.front().first.result();
+    in_flight.pop_front();
+    QByteArray block = std::move(outputs.front());
+    outputs.pop_front();
+    consumed_ = qint64(frames[done].offset + frames[done].size);
+    done++;
+    if (!ok)
+    {
+      setError(QObject::tr("Corrupted zstd frame"));
+    }
+    else if (!block.isEmpty() && !pushBlock(std::move(block)))
+    {
+      break;
+    }
+  }
+  // The running frames read the mapping, it stays valid until they are done
+  for (auto& [future, output] : in_flight)
+  {
+    future.waitForFinished();
+  }
+  return ok;
+#else
+  return false;
+#endif
+}
+
+bool CompressedLogReader::decompressZstdStream()
+{
+#ifdef HAVE_ZSTD
+  ZSTD_DStream* stream = ZSTD_createDStream();
+  ZSTD_initDStream(stream);
+  ZSTD_inBuffer input = { data_, size_t(size_), 0 };
+  bool ok = true;
+  size_t ret = 0;
+  bool output_full = false;
+  // A full output block may leave decompressed data behind, even once the input is consumed
+  while (input.pos < input.size || output_full)
+  {
+    QByteArray output(BLOCK_SIZE, Qt::Uninitialized);
+    ZSTD_outBuffer out_buffer = { output.data(), size_t(BLOCK_SIZE), 0 };
+    ret = ZSTD_decompressStream(stream, &out_buffer, &input);
+    consumed_ = qint64(input.pos);
+    if (ZSTD_isError(ret))
+    {
+      setError(QObject::tr("Corrupted zstd data: %1").arg(ZSTD_getErrorName(ret)));
+      ok = false;
+      break;
+    }
+    output_full = out_buffer.pos == out_buffer.size;
+    output.resize(int(out_buffer.pos));
+    if (!output.isEmpty() && !pushBlock(std::move(output)))
+    {
+      break;
+    }
+  }
+  if (ok && ret != 0 && input.pos == input.size)
+  {
+    setError(QObject::tr("Truncated zstd data"));
+    ok = false;
+  }
+  ZSTD_freeDStream(stream);
+  return ok;
+#else
+  return false;
+#endif
+}
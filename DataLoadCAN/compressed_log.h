@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Decompresses a compressed candump log (.gz, .zst, .xz) on a background thread, a few blocks ahead of
+// the parser. Zstandard files made of independent frames (zstd --seekable, pzstd) are decompressed
+// frame by frame on all cores. Each format is available if its library was found at build time.
+class CompressedLogReader
+{
+public:
+  enum Format
+  {
+    NONE,
+    GZIP,
+    ZSTD,
+    XZ
+  };
+  static Format formatOf(const QString& filename);
+  static bool isSupported(Format format);
+  // Extensions of the supported formats, without the dot
+  static std::vector<const char*> supportedExtensions();
+
+  ~CompressedLogReader();
+
+  bool open(const QString& filename, QString* error_string);
+  void close();
+
+  // Next block of decompressed data holding whole lines, false at the end of the stream.
+  // Check errorString() afterwards to tell the end from a corrupted file.
+  bool nextBlock(QByteArray& block);
+  QString errorString() const;
+
+  qint64 compressedSize() const
+  {
+    return size_;
+  }
+  // Compressed bytes decompressed so far, for progress reports
+  qint64 compressedConsumed() const
+  {
+    return consumed_.load(std::memory_order_relaxed);
+  }
+
+private:
+  static const int BLOCK_SIZE = 4 << 20;
+  static const size_t MAX_QUEUED_BLOCKS = 4;
+
+  void decompress();
+  bool decompressGzip();
+  bool decompressXz();
+  bool decompressZstd();
+  bool decompressZstdStream();
+  // Queues a block for the parser, waits while the queue is full. Returns false once closing.
+  bool pushBlock(QByteArray block);
+  void setError(const QString& error);
+
+  QFile file_;
+  Format format_ = NONE;
+  const uint8_t* data_ = nullptr;
+  qint64 size_ = 0;
+  std::atomic<qint64> consumed_{ 0 };
+  std::thread thread_;
+
+  // Blocks between the decompression thread and the parser
+  mutable std::mutex mutex_;
+  std::condition_variable queue_changed_;
+  std::deque<QByteArray> blocks_;
+  bool finished_ = false;
+  bool closing_ = false;
+  QString error_;
+
+  // Partial last line of the previous block, parser side
+  QByteArray remainder_;
+};
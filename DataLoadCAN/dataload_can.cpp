@@ -6,21 +6,83 @@
 #include <QProgressDialog>
 #include <QFileDialog>
 #include <QRegularExpression>
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
 
 #include <fstream>
 #include <cstring>
 #include <clocale>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <unordered_set>
 #include "dataload_can.h"
+#include "../PluginsCommonCAN/CandumpLine.h"
+#include "compressed_log.h"
 #include "../PluginsCommonCAN/select_can_database.h"
+#include "select_signals.h"
 
-// Regular expression for log files created by candump -L
-// Captured groups: time, channel, frame_id, payload
-const QRegularExpression canlog_rgx("\\((?<time>\\d*\\.\\d*)\\)\\s*(?<can_channel>[\\S]*)\\s*(?<id>[0-9a-fA-F]{3,8})\\#(?<data>[0-9a-fA-F]*)");
-const QRegularExpression canfd_log_rgx("\\((?<time>\\d*\\.\\d*)\\)\\s*(?<can_channel>[\\S]*)\\s*(?<id>[0-9a-fA-F]{3,8})\\#(?<flag>\\#[0-1])(?<data>[0-9a-fA-F]*)");
+namespace
+{
+// Statistics are published per second of log time
+const double STATISTICS_INTERVAL_SECS = 1.0;
+// The decoding runs on a worker thread, the progress dialog is refreshed from the GUI thread
+const int PROGRESS_INTERVAL_MS = 100;
+
+// Returns the line starting at offset in the mapped log and moves offset to the next line
+QString readMappedLine(const char* data, qint64 size, qint64& offset)
+{
+  const char* line_ptr = data + offset;
+  const char* eol = static_cast<const char*>(memchr(line_ptr, '\n', size - offset));
+  qint64 line_len = eol ? eol - line_ptr : size - offset;
+  offset += line_len + 1;
+  if (line_len > 0 && line_ptr[line_len - 1] == '\r')
+  {
+    line_len--;
+  }
+  return QString::fromLatin1(line_ptr, line_len);
+}
+
+// Runs work on a worker thread while the progress dialog keeps the GUI responsive. work stores the
+// number of items done in progress and returns early once cancel is set.
+// Returns false if the user cancelled.
+bool runInBackground(QProgressDialog& progress_dialog,
+                     const std::function<void(std::atomic<int>& progress, const std::atomic<bool>& cancel)>& work)
+{
+  std::atomic<int> progress{ 0 };
+  std::atomic<bool> cancel{ false };
+  QEventLoop loop;
+  QFutureWatcher<void> watcher;
+  QTimer progress_timer;
+  // The loop is the context of the connections, they end with this call
+  QObject::connect(&watcher, &QFutureWatcher<void>::finished, &loop, &QEventLoop::quit);
+  QObject::connect(&progress_dialog, &QProgressDialog::canceled, &loop, [&cancel]() { cancel = true; });
+  QObject::connect(&progress_timer, &QTimer::timeout, &loop, [&]() {
+    if (!cancel)
+    {
+      progress_dialog.setValue(progress.load(std::memory_order_relaxed));
+    }
+  });
+  progress_timer.start(PROGRESS_INTERVAL_MS);
+  watcher.setFuture(QtConcurrent::run([&]() { work(progress, cancel); }));
+  loop.exec();
+  progress_timer.stop();
+  return !cancel;
+}
+}  // namespace
 
 DataLoadCAN::DataLoadCAN()
 {
   extensions_.push_back("log");
+  extensions_.push_back("pjcan");
+  for (const char* extension : CompressedLogReader::supportedExtensions())
+  {
+    extensions_.push_back(extension);
+  }
 }
 
 const std::vector<const char*>& DataLoadCAN::compatibleFileExtensions() const
@@ -43,18 +105,16 @@ bool DataLoadCAN::loadCANDatabase(std::string dbc_file_location,
 
 QSize DataLoadCAN::inspectFile(QFile* file)
 {
-  QTextStream inA(file);
-  int linecount = 0;
-
-  while (!inA.atEnd())
+  // The sparse index is kept next to the log, so the log is scanned only on its first load
+  if (!log_index_.load(*file))
   {
-    inA.readLine();
-    linecount++;
+    log_index_.build(*file);
+    log_index_.save(*file);
   }
 
   QSize table_size;
   table_size.setWidth(4);
-  table_size.setHeight(linecount);
+  table_size.setHeight(log_index_.lineCount());
 
   return table_size;
 }
@@ -69,6 +129,15 @@ bool DataLoadCAN::readDataFromFile(FileLoadInfo* fileload_info, PlotDataMapRef&
     xmlLoadState(fileload_info->plugin_config.firstChildElement());
   }
 
+  if (fileload_info->filename.endsWith(".pjcan"))
+  {
+    return readArchiveFile(fileload_info, plot_data_map);
+  }
+  if (CompressedLogReader::formatOf(fileload_info->filename) != CompressedLogReader::NONE)
+  {
+    return readCompressedLog(fileload_info, plot_data_map);
+  }
+
   const int TIME_INDEX_NOT_DEFINED = -2;
 
   int time_index = TIME_INDEX_NOT_DEFINED;
@@ -84,28 +153,49 @@ bool DataLoadCAN::readDataFromFile(FileLoadInfo* fileload_info, PlotDataMapRef&
   file.close();
 
   DialogSelectCanDatabase* dialog = new DialogSelectCanDatabase();
+  dialog->setSignalPatterns(signal_include_, signal_exclude_);
+  dialog->setLogDuration(log_index_.lastTimestamp() - log_index_.firstTimestamp());
 
   if (dialog->exec() != static_cast<int>(QDialog::Accepted))
   {
     return false;
   }
-  // load dbc data file
-  loadCANDatabase(dialog->GetDatabaseLocation().toStdString(),
-                  dialog->GetCanProtocol(), 
-                  plot_data_map,
-                  dialog->getNameFilterList());
+  configureFrameProcessor(*dialog);
 
+  // Seek to the indexed line preceding the time window, lines after the window are not read
+  const double window_start = log_index_.firstTimestamp() + dialog->getTimeWindowStart();
+  const double window_end = log_index_.firstTimestamp() + dialog->getTimeWindowEnd();
   file.open(QFile::ReadOnly);
-  QTextStream inB(&file);
-
-  bool interrupted = false;
+  const qint64 file_size = file.size();
+  const char* file_data = reinterpret_cast<const char*>(file.map(0, file_size));
+  if (file_size > 0 && !file_data)
+  {
+    QMessageBox::warning(0, tr("Error"), tr("Could not map %1 into memory").arg(fileload_info->filename));
+    rollbackLoad();
+    return false;
+  }
+  // In lazy mode frames are only indexed by id in the first pass, and the selected ones decoded afterwards
+  const bool lazy_decode = dialog->isLazyDecodeEnabled();
+  std::unordered_map<uint64_t, std::vector<qint64>> frame_offsets;
+  // Frames are decoded in batches per id, unless statistics need them in time order
+  const bool batch_decode = !dialog->isStatisticsEnabled();
+  auto decodeFrame = [&](const CanLogFrame& frame) {
+    if (batch_decode)
+    {
+      frame_processor_->queueCanFrame(frame.id, frame.data, frame.dlc, frame.time);
+    }
+    else
+    {
+      frame_processor_->ProcessCanFrame(frame.id, frame.data, frame.dlc, frame.time);
+    }
+  };
 
   int linecount = 0;
 
   QProgressDialog progress_dialog;
-  progress_dialog.setLabelText("Loading... please wait");
+  progress_dialog.setLabelText(lazy_decode ? "Indexing... please wait" : "Loading... please wait");
   progress_dialog.setWindowModality(Qt::ApplicationModal);
-  progress_dialog.setRange(0, tot_lines);
+  progress_dialog.setRange(0, std::min<qint64>(tot_lines, log_index_.estimateLines(window_start, window_end)));
   progress_dialog.setAutoClose(true);
   progress_dialog.setAutoReset(true);
   progress_dialog.show();
@@ -114,60 +204,139 @@ bool DataLoadCAN::readDataFromFile(FileLoadInfo* fileload_info, PlotDataMapRef&
   // To have . as decimal seperator, save current locale and change it.
   const auto oldLocale = std::setlocale(LC_NUMERIC, nullptr);
   std::setlocale(LC_NUMERIC, "C");
-  while (!inB.atEnd())
-  {
-    QString line = inB.readLine();
-    // qDebug() << line;
-    static QRegularExpressionMatchIterator rxIterator;
-    if(!frame_processor_->isExtendedId())
-    {
-      rxIterator = canlog_rgx.globalMatch(line);
-    } 
-    else 
+  // Nothing of a cancelled load is kept
+  auto cancelLoad = [&]() {
+    std::setlocale(LC_NUMERIC, oldLocale);
+    rollbackLoad();
+    return false;
+  };
+
+  bool completed = runInBackground(progress_dialog, [&](std::atomic<int>& progress, const std::atomic<bool>& cancel) {
+    qint64 offset = log_index_.seekOffset(window_start);
+    while (offset < file_size && !cancel.load(std::memory_order_relaxed))
     {
-      rxIterator = canfd_log_rgx.globalMatch(line);
+      const qint64 line_offset = offset;
+      CanLogFrame frame;
+      if (!parseLogLine(readMappedLine(file_data, file_size, offset), frame))
+      {
+        continue;  // skip invalid lines
+      }
+      if (frame.time < window_start)
+      {
+        continue;
+      }
+      if (frame.time > window_end)
+      {
+        break;
+      }
+      // The bus load covers every frame, the id filter only applies to decoding
+      if (bus_load_)
+      {
+        bus_load_->addFrame(frame.time, frame.id, frame.flags, frame.dlc);
+      }
+      const bool has_data = !(frame.flags & (RawFrameRecord::REMOTE_REQUEST | RawFrameRecord::ERROR_FRAME));
+      if (has_data && lazy_decode)
+      {
+        if (frame_processor_->passesIdFilter(frame.id))
+        {
+          frame_offsets[frame.id].push_back(line_offset);
+        }
+      }
+      else if (has_data)
+      {
+        decodeFrame(frame);
+      }
+      progress.store(++linecount, std::memory_order_relaxed);
     }
-    if (!rxIterator.hasNext())
+  });
+  if (!completed)
+  {
+    return cancelLoad();
+  }
+
+  if (lazy_decode)
+  {
+    // Every series the indexed frames decode into, with the frame ids producing it
+    std::map<std::string, std::vector<uint64_t>> series_frame_ids;
+    for (const auto& [frame_id, offsets] : frame_offsets)
     {
-      continue;  // skip invalid lines
+      for (const std::string& name : frame_processor_->seriesNames(frame_id))
+      {
+        series_frame_ids[name].push_back(frame_id);
+      }
     }
-    QRegularExpressionMatch canFrame = rxIterator.next();
-    uint64_t frameId = std::stoul(canFrame.captured("id").toStdString(), 0, 16);
-    double frameTime = std::stod(canFrame.captured("time").toStdString());
-
-    int dlc = canFrame.capturedLength("data") / 2;
-    uint8_t frameDataBytes[MAX_DATA_SIZE];
-    QByteArray buffer = QByteArray::fromHex(canFrame.captured("data").toUtf8());
-    memcpy(frameDataBytes,buffer.data(), dlc);
-    // apply id filter only when filter list is not empty
-    if(dialog->getIdFilterList().find(frameId) == dialog->getIdFilterList().end() &&
-       !dialog->getIdFilterList().empty())
+    // A reload reuses the previous selection
+    QStringList selected = fileload_info->selected_datasources;
+    if (!use_provided_configuration || selected.empty())
     {
-      continue;
+      QStringList signal_names;
+      for (const auto& [name, frame_ids] : series_frame_ids)
+      {
+        signal_names.push_back(QString::fromStdString(name));
+      }
+      DialogSelectSignals signal_dialog(signal_names, selected);
+      if (signal_dialog.exec() != static_cast<int>(QDialog::Accepted))
+      {
+        return cancelLoad();
+      }
+      selected = signal_dialog.selectedSignals();
+      fileload_info->selected_datasources = selected;
     }
-    frame_processor_->ProcessCanFrame(frameId, frameDataBytes, dlc, frameTime);
-    //------ progress dialog --------------
-    if (linecount++ % 100 == 0)
+
+    std::unordered_set<std::string> selection;
+    std::unordered_set<uint64_t> selected_frame_ids;
+    for (const QString& name : selected)
     {
-      progress_dialog.setValue(linecount);
-      QApplication::processEvents();
+      auto it = series_frame_ids.find(name.toStdString());
+      if (it != series_frame_ids.end())
+      {
+        selection.insert(it->first);
+        selected_frame_ids.insert(it->second.begin(), it->second.end());
+      }
+    }
+    frame_processor_->setSeriesSelection(selection);
 
-      if (progress_dialog.wasCanceled())
+    // Decode the frames of the selected ids in file order
+    std::vector<qint64> decode_offsets;
+    for (uint64_t frame_id : selected_frame_ids)
+    {
+      const auto& offsets = frame_offsets[frame_id];
+      decode_offsets.insert(decode_offsets.end(), offsets.begin(), offsets.end());
+    }
+    std::sort(decode_offsets.begin(), decode_offsets.end());
+
+    linecount = 0;
+    progress_dialog.setLabelText("Loading... please wait");
+    progress_dialog.setRange(0, decode_offsets.size());
+    progress_dialog.show();
+    completed = runInBackground(progress_dialog, [&](std::atomic<int>& progress, const std::atomic<bool>& cancel) {
+      for (qint64 line_offset : decode_offsets)
       {
-        return false;
+        if (cancel.load(std::memory_order_relaxed))
+        {
+          return;
+        }
+        CanLogFrame frame;
+        if (parseLogLine(readMappedLine(file_data, file_size, line_offset), frame))
+        {
+          decodeFrame(frame);
+        }
+        progress.store(++linecount, std::memory_order_relaxed);
       }
+    });
+    if (!completed)
+    {
+      return cancelLoad();
     }
   }
+  frame_processor_->flushBatches();
+  // Store the last sample of the series held back by change-only mode
+  frame_processor_->flushPendingSamples();
+  commitLoad(plot_data_map);
   // Restore locale setting
   std::setlocale(LC_NUMERIC, oldLocale);
   file.close();
 
-  if (interrupted)
-  {
-    progress_dialog.cancel();
-    plot_data_map.numeric.clear();
-  }
-
   if (monotonic_warning)
   {
     QString message =
@@ -181,6 +350,237 @@ bool DataLoadCAN::readDataFromFile(FileLoadInfo* fileload_info, PlotDataMapRef&
   return true;
 }
 
+bool DataLoadCAN::readArchiveFile(FileLoadInfo* fileload_info, PlotDataMapRef& plot_data_map)
+{
+  RawFrameArchiveReader archive;
+  if (!archive.open(fileload_info->filename))
+  {
+    QMessageBox::warning(0, tr("Error"), tr("%1 is not a valid raw frame archive").arg(fileload_info->filename));
+    return false;
+  }
+
+  DialogSelectCanDatabase* dialog = new DialogSelectCanDatabase();
+  dialog->setSignalPatterns(signal_include_, signal_exclude_);
+  if (archive.size() > 0)
+  {
+    dialog->setLogDuration(archive.at(archive.size() - 1).timestamp_secs - archive.at(0).timestamp_secs);
+  }
+  if (dialog->exec() != static_cast<int>(QDialog::Accepted))
+  {
+    return false;
+  }
+  configureFrameProcessor(*dialog);
+
+  // Records have a fixed size, the time window is found by binary search without an index
+  uint64_t first = 0;
+  uint64_t last = archive.size();
+  if (archive.size() > 0)
+  {
+    const double start_time = archive.at(0).timestamp_secs;
+    first = archive.lowerBound(start_time + dialog->getTimeWindowStart());
+    last = archive.lowerBound(std::nextafter(start_time + dialog->getTimeWindowEnd(), INFINITY));
+  }
+
+  QProgressDialog progress_dialog;
+  progress_dialog.setLabelText("Loading... please wait");
+  progress_dialog.setWindowModality(Qt::ApplicationModal);
+  // Progress is counted in thousands of frames, archives easily exceed the int range
+  progress_dialog.setRange(0, (last - first) / 1000);
+  progress_dialog.setAutoClose(true);
+  progress_dialog.setAutoReset(true);
+  progress_dialog.show();
+
+  const bool batch_decode = !dialog->isStatisticsEnabled();
+  const bool completed = runInBackground(progress_dialog, [&](std::atomic<int>& progress, const std::atomic<bool>& cancel) {
+    for (uint64_t i = first; i < last && !cancel.load(std::memory_order_relaxed); i++)
+    {
+      const RawFrameRecord& record = archive.at(i);
+      if (bus_load_)
+      {
+        bus_load_->addFrame(record.timestamp_secs, record.frame_id, record.flags, record.data_len);
+      }
+      const bool has_data = !(record.flags & (RawFrameRecord::REMOTE_REQUEST | RawFrameRecord::ERROR_FRAME));
+      if (has_data && batch_decode)
+      {
+        frame_processor_->queueCanFrame(record.frame_id, record.data, record.data_len, record.timestamp_secs);
+      }
+      else if (has_data)
+      {
+        frame_processor_->ProcessCanFrame(record.frame_id, record.data, record.data_len, record.timestamp_secs);
+      }
+      progress.store((i - first) / 1000, std::memory_order_relaxed);
+    }
+  });
+  if (!completed)
+  {
+    rollbackLoad();
+    return false;
+  }
+  frame_processor_->flushBatches();
+  frame_processor_->flushPendingSamples();
+  commitLoad(plot_data_map);
+  return true;
+}
+
+bool DataLoadCAN::readCompressedLog(FileLoadInfo* fileload_info, PlotDataMapRef& plot_data_map)
+{
+  CompressedLogReader reader;
+  QString error_string;
+  if (!reader.open(fileload_info->filename, &error_string))
+  {
+    QMessageBox::warning(0, tr("Error"), error_string);
+    return false;
+  }
+
+  DialogSelectCanDatabase* dialog = new DialogSelectCanDatabase();
+  dialog->setSignalPatterns(signal_include_, signal_exclude_);
+  if (dialog->exec() != static_cast<int>(QDialog::Accepted))
+  {
+    return false;
+  }
+  configureFrameProcessor(*dialog);
+
+  QProgressDialog progress_dialog;
+  progress_dialog.setLabelText("Loading... please wait");
+  progress_dialog.setWindowModality(Qt::ApplicationModal);
+  // Progress is counted in compressed kB, the number of lines is unknown
+  progress_dialog.setRange(0, reader.compressedSize() / 1024);
+  progress_dialog.setAutoClose(true);
+  progress_dialog.setAutoReset(true);
+  progress_dialog.show();
+
+  // There is no index of a compressed log, every line is parsed and the time window is checked per frame.
+  // Lazy decoding needs line offsets in a mapped log and does not apply.
+  const bool batch_decode = !dialog->isStatisticsEnabled();
+  const bool completed = runInBackground(progress_dialog, [&](std::atomic<int>& progress, const std::atomic<bool>& cancel) {
+    bool has_first_timestamp = false;
+    double window_start = 0.0;
+    double window_end = 0.0;
+    QByteArray block;
+    while (!cancel.load(std::memory_order_relaxed) && reader.nextBlock(block))
+    {
+      for (qint64 offset = 0; offset < block.size();)
+      {
+        CanLogFrame frame;
+        if (!parseLogLine(readMappedLine(block.constData(), block.size(), offset), frame))
+        {
+          continue;  // skip invalid lines
+        }
+        if (!has_first_timestamp)
+        {
+          has_first_timestamp = true;
+          window_start = frame.time + dialog->getTimeWindowStart();
+          window_end = frame.time + dialog->getTimeWindowEnd();
+        }
+        if (frame.time < window_start)
+        {
+          continue;
+        }
+        if (frame.time > window_end)
+        {
+          return;
+        }
+        if (bus_load_)
+        {
+          bus_load_->addFrame(frame.time, frame.id, frame.flags, frame.dlc);
+        }
+        const bool has_data = !(frame.flags & (RawFrameRecord::REMOTE_REQUEST | RawFrameRecord::ERROR_FRAME));
+        if (has_data && batch_decode)
+        {
+          frame_processor_->queueCanFrame(frame.id, frame.data, frame.dlc, frame.time);
+        }
+        else if (has_data)
+        {
+          frame_processor_->ProcessCanFrame(frame.id, frame.data, frame.dlc, frame.time);
+        }
+      }
+      progress.store(int(reader.compressedConsumed() / 1024), std::memory_order_relaxed);
+    }
+  });
+  if (!completed)
+  {
+    rollbackLoad();
+    return false;
+  }
+  if (!reader.errorString().isEmpty())
+  {
+    QMessageBox::warning(0, tr("Warning"), tr("%1, the frames before the error are loaded").arg(reader.errorString()));
+  }
+  frame_processor_->flushBatches();
+  frame_processor_->flushPendingSamples();
+  commitLoad(plot_data_map);
+  return true;
+}
+
+void DataLoadCAN::commitLoad(PlotDataMapRef& plot_data_map)
+{
+  // The processor and the monitor point into the series of the load
+  frame_processor_.reset();
+  bus_load_.reset();
+  while (!load_data_.numeric.empty())
+  {
+    // New series are moved as a whole, samples of existing ones are appended
+    auto node = load_data_.numeric.extract(load_data_.numeric.begin());
+    auto plot_it = plot_data_map.numeric.find(node.key());
+    if (plot_it == plot_data_map.numeric.end())
+    {
+      plot_data_map.numeric.insert(std::move(node));
+      continue;
+    }
+    for (const auto& point : node.mapped())
+    {
+      plot_it->second.pushBack(point);
+    }
+  }
+}
+
+void DataLoadCAN::rollbackLoad()
+{
+  frame_processor_.reset();
+  bus_load_.reset();
+  load_data_.clear();
+}
+
+void DataLoadCAN::configureFrameProcessor(const DialogSelectCanDatabase& dialog)
+{
+  // The load decodes into its own map, merged into the plot data only once it completes
+  load_data_.clear();
+  // load dbc data file
+  loadCANDatabase(dialog.GetDatabaseLocation().toStdString(),
+                  dialog.GetCanProtocol(),
+                  load_data_,
+                  dialog.getNameFilterList());
+  frame_processor_->setIdFilter(dialog.getIdFilterList());
+  signal_include_ = dialog.getSignalIncludePatterns();
+  signal_exclude_ = dialog.getSignalExcludePatterns();
+  frame_processor_->setSignalSelection(signal_include_, signal_exclude_);
+  frame_processor_->setStatisticsInterval(dialog.isStatisticsEnabled() ? STATISTICS_INTERVAL_SECS : 0.0);
+  frame_processor_->setChangeOnlyMode(dialog.isChangeOnlyEnabled(), dialog.getDeadband());
+  frame_processor_->setIsoTpChannels(dialog.getIsoTpChannels());
+  frame_processor_->setRetentionPolicy(dialog.getRetentionPolicy());
+  bus_load_.reset();
+  if (dialog.isBusLoadEnabled())
+  {
+    bus_load_ = std::make_unique<BusLoadMonitor>(load_data_);
+    bus_load_->setBitrate(dialog.getBitrate(), dialog.getDataBitrate());
+  }
+}
+
+bool DataLoadCAN::parseLogLine(const QString& line, CanLogFrame& frame) const
+{
+  RawFrameRecord record;
+  if (!parseCandumpLine(line, frame_processor_->isExtendedId(), record))
+  {
+    return false;
+  }
+  frame.id = record.frame_id;
+  frame.time = record.timestamp_secs;
+  frame.flags = record.flags;
+  frame.dlc = record.data_len;
+  memcpy(frame.data, record.data, record.data_len);
+  return true;
+}
+
 DataLoadCAN::~DataLoadCAN()
 {
 }
@@ -191,11 +591,22 @@ bool DataLoadCAN::xmlSaveState(QDomDocument& doc, QDomElement& parent_element) c
   elem.setAttribute("time_axis", default_time_axis_.c_str());
 
   parent_element.appendChild(elem);
+
+  QDomElement selection = doc.createElement("signal_selection");
+  selection.setAttribute("include", QString::fromStdString(NameMatcher::joinPatterns(signal_include_)));
+  selection.setAttribute("exclude", QString::fromStdString(NameMatcher::joinPatterns(signal_exclude_)));
+  parent_element.appendChild(selection);
   return true;
 }
 
 bool DataLoadCAN::xmlLoadState(const QDomElement& parent_element)
 {
+  QDomElement selection = parent_element.firstChildElement("signal_selection");
+  if (!selection.isNull())
+  {
+    signal_include_ = NameMatcher::splitPatterns(selection.attribute("include").toStdString());
+    signal_exclude_ = NameMatcher::splitPatterns(selection.attribute("exclude").toStdString());
+  }
   QDomElement elem = parent_element.firstChildElement("default");
   if (!elem.isNull())
   {
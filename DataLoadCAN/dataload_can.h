@@ -2,14 +2,29 @@
 
 #include <QObject>
 #include <QtPlugin>
+#include <unordered_set>
 #include <PlotJuggler/dataloader_base.h>
+#include "../PluginsCommonCAN/BusLoadMonitor.h"
 #include "../PluginsCommonCAN/CanFrameProcessor.h"
+#include "../PluginsCommonCAN/RawFrameArchive.h"
+#include "canlog_index.h"
+
+class DialogSelectCanDatabase;
 
 using namespace PJ;
 
 const uint64_t EXTENDED_IDENTIFIER = 2147483648;
 const uint8_t MAX_DATA_SIZE = 64;
 
+struct CanLogFrame
+{
+  uint64_t id;
+  double time;
+  int dlc;
+  uint8_t flags;  // RawFrameRecord::Flags
+  uint8_t data[MAX_DATA_SIZE];
+};
+
 class DataLoadCAN : public DataLoader
 {
   Q_OBJECT
@@ -37,9 +52,27 @@ public:
 
 private:
   uint64_t getId (const uint64_t frame_id);
+  // Load a raw frame archive recorded by DataStreamCAN
+  bool readArchiveFile(FileLoadInfo* fileload_info, PlotDataMapRef& plot_data_map);
+  // Load a candump log compressed with gzip, zstd or xz, decompressed while it is parsed
+  bool readCompressedLog(FileLoadInfo* fileload_info, PlotDataMapRef& plot_data_map);
+  // Moves the series of a completed load into plot_data_map, appending to the series it already has
+  void commitLoad(PlotDataMapRef& plot_data_map);
+  // Drops the series of a cancelled load, plot_data_map is left as it was
+  void rollbackLoad();
+  void configureFrameProcessor(const DialogSelectCanDatabase& dialog);
+  // Parse a line of a candump -L log, false for invalid lines
+  bool parseLogLine(const QString& line, CanLogFrame& frame) const;
 private:
   std::vector<const char *> extensions_;
   std::string default_time_axis_;
   std::unique_ptr<CanFrameProcessor> frame_processor_;
+  std::unique_ptr<BusLoadMonitor> bus_load_;
+  // Series decoded by the load in progress
+  PlotDataMapRef load_data_;
+  CanLogIndex log_index_;
+  // Signal selection of the last load, saved in the layout
+  std::vector<std::string> signal_include_;
+  std::vector<std::string> signal_exclude_;
   bool is_extended_id_ = false;
 };
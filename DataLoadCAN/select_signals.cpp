@@ -0,0 +1,67 @@
+#include <QListWidgetItem>
+
+#include "select_signals.h"
+#include "ui_select_signals.h"
+
+DialogSelectSignals::DialogSelectSignals(const QStringList& signal_names, const QStringList& selected,
+                                         QWidget* parent)
+  : QDialog(parent), m_ui(new Ui::DialogSelectSignals)
+{
+  m_ui->setupUi(this);
+
+  for (const QString& name : signal_names)
+  {
+    auto item = new QListWidgetItem(name, m_ui->signalList);
+    item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+    item->setCheckState(selected.contains(name) ? Qt::Checked : Qt::Unchecked);
+  }
+
+  connect(m_ui->okButton, &QPushButton::clicked, this, &QDialog::accept);
+  connect(m_ui->cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+  connect(m_ui->filterEdit, &QLineEdit::textChanged, this, &DialogSelectSignals::filterChanged);
+  connect(m_ui->selectAllButton, &QPushButton::clicked, this, [this]() { setShownChecked(true); });
+  connect(m_ui->selectNoneButton, &QPushButton::clicked, this, [this]() {
+    m_ui->filterEdit->clear();
+    setShownChecked(false);
+  });
+}
+
+QStringList DialogSelectSignals::selectedSignals() const
+{
+  QStringList selected;
+  for (int i = 0; i < m_ui->signalList->count(); i++)
+  {
+    const QListWidgetItem* item = m_ui->signalList->item(i);
+    if (item->checkState() == Qt::Checked)
+    {
+      selected.push_back(item->text());
+    }
+  }
+  return selected;
+}
+
+DialogSelectSignals::~DialogSelectSignals()
+{
+  delete m_ui;
+}
+
+void DialogSelectSignals::filterChanged(const QString& text)
+{
+  for (int i = 0; i < m_ui->signalList->count(); i++)
+  {
+    QListWidgetItem* item = m_ui->signalList->item(i);
+    item->setHidden(!item->text().contains(text, Qt::CaseInsensitive));
+  }
+}
+
+void DialogSelectSignals::setShownChecked(bool checked)
+{
+  for (int i = 0; i < m_ui->signalList->count(); i++)
+  {
+    QListWidgetItem* item = m_ui->signalList->item(i);
+    if (!item->isHidden())
+    {
+      item->setCheckState(checked ? Qt::Checked : Qt::Unchecked);
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QDialog>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+namespace Ui
+{
+class DialogSelectSignals;
+}
+QT_END_NAMESPACE
+
+// Lists the series found in an indexed log, only the checked ones get decoded
+class DialogSelectSignals : public QDialog
+{
+  Q_OBJECT
+
+public:
+  DialogSelectSignals(const QStringList& signal_names, const QStringList& selected, QWidget* parent = nullptr);
+  QStringList selectedSignals() const;
+
+  ~DialogSelectSignals() override;
+
+private slots:
+  void filterChanged(const QString& text);
+  void setShownChecked(bool checked);
+
+private:
+  Ui::DialogSelectSignals* m_ui;
+};
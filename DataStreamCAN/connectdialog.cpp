@@ -54,6 +54,7 @@
 
 #include <QCanBus>
 #include <QDebug>
+#include <QThread>
 
 #include <algorithm>
 #include <sstream>
@@ -80,6 +81,12 @@ ConnectDialog::ConnectDialog(QWidget *parent) :
 
     m_ui->dataBitrateBox->setFlexibleDateRateEnabled(true);
 
+    m_ui->dropPolicyBox->addItem(tr("Drop oldest"), QVariant(IngestQueue::DROP_OLDEST));
+    m_ui->dropPolicyBox->addItem(tr("Decimate per ID"), QVariant(IngestQueue::DECIMATE_PER_ID));
+
+    // One decoder thread per core at most
+    m_ui->decoderThreadsBox->setMaximum(std::max(1, QThread::idealThreadCount()));
+
     m_ui->okButton->setEnabled(false);
 
     connect(m_ui->okButton, &QPushButton::clicked, this, &ConnectDialog::ok);
@@ -92,6 +99,12 @@ ConnectDialog::ConnectDialog(QWidget *parent) :
             this, &ConnectDialog::interfaceChanged);
     connect(m_ui->loadDatabaseButton, &QPushButton::clicked,
             this, &ConnectDialog::importDatabaseLocation);
+    connect(m_ui->browseArchiveButton, &QPushButton::clicked,
+            this, &ConnectDialog::browseArchiveFile);
+    connect(m_ui->browseLogButton, &QPushButton::clicked,
+            this, &ConnectDialog::browseLogFile);
+    connect(m_ui->browseTraceButton, &QPushButton::clicked,
+            this, &ConnectDialog::browseTraceFile);
     m_ui->rawFilterEdit->hide();
     m_ui->rawFilterLabel->hide();
     
@@ -214,6 +227,37 @@ void ConnectDialog::updateSettings()
     m_currentSettings.pluginName = m_ui->pluginListBox->currentText();
     m_currentSettings.deviceInterfaceName = m_ui->interfaceListBox->currentText();
     m_currentSettings.useConfigurationEnabled = m_ui->useConfigurationBox->isChecked();
+    m_currentSettings.recordArchive = m_ui->recordArchiveBox->isChecked() &&
+                                      !m_ui->archiveFileEdit->text().isEmpty();
+    m_currentSettings.archiveFile = m_ui->archiveFileEdit->text();
+    m_currentSettings.archiveSizeMb = m_ui->archiveSizeBox->value();
+    m_currentSettings.tierFactor = m_ui->tierFactorBox->value();
+    m_currentSettings.tierLevels = m_ui->tiersBox->isChecked() ? m_ui->tierLevelsBox->value() : 0;
+    m_currentSettings.decoderThreads = m_ui->decoderThreadsBox->value();
+    m_currentSettings.followLog = m_ui->followLogBox->isChecked() && !m_ui->logFileEdit->text().isEmpty();
+    m_currentSettings.logFile = m_ui->logFileEdit->text();
+    m_currentSettings.sharedRing = m_ui->sharedRingBox->isChecked() && !m_ui->ringNameEdit->text().isEmpty();
+    m_currentSettings.ringName = m_ui->ringNameEdit->text();
+    m_currentSettings.udpReceive = m_ui->udpBox->isChecked();
+    m_currentSettings.udpAddress = m_ui->udpAddressEdit->text();
+    m_currentSettings.udpPort = m_ui->udpPortBox->value();
+    m_currentSettings.traceLatency = m_ui->traceBox->isChecked();
+    m_currentSettings.traceFile = m_ui->traceFileEdit->text();
+    m_currentSettings.overloadLimit = m_ui->overloadBox->isChecked();
+    m_currentSettings.queueCapacity = m_ui->queueCapacityBox->value();
+    m_currentSettings.dropPolicy = static_cast<IngestQueue::DropPolicy>(m_ui->dropPolicyBox->currentData().toInt());
+    m_currentSettings.priorityIds.clear();
+    QRegularExpression id_re("(\\w+)");
+    auto id_it = id_re.globalMatch(m_ui->priorityIdsEdit->text());
+    while (id_it.hasNext())
+    {
+        bool ok = false;
+        const uint64_t id = id_it.next().captured(1).toULongLong(&ok, 16);
+        if (ok)
+        {
+            m_currentSettings.priorityIds.insert(id);
+        }
+    }
 
     if (m_currentSettings.useConfigurationEnabled)
     {
@@ -297,6 +341,8 @@ void ConnectDialog::updateSettings()
 void ConnectDialog::importDatabaseLocation()
 {
     DialogSelectCanDatabase* dialog = new DialogSelectCanDatabase();
+    dialog->setFileLoadOptionsAvailable(false);
+    dialog->setSignalPatterns(m_currentSettings.signalInclude, m_currentSettings.signalExclude);
     if (dialog->exec() != static_cast<int>(QDialog::Accepted))
     {
         ConnectDialog::cancel();
@@ -307,6 +353,50 @@ void ConnectDialog::importDatabaseLocation()
     m_currentSettings.protocol = dialog->GetCanProtocol();
     m_currentSettings.m_filter_list = dialog->getNameFilterList();
     m_currentSettings.m_id_filter_list = dialog->getIdFilterList();
+    m_currentSettings.signalInclude = dialog->getSignalIncludePatterns();
+    m_currentSettings.signalExclude = dialog->getSignalExcludePatterns();
+    m_currentSettings.isoTpChannels = dialog->getIsoTpChannels();
+    m_currentSettings.statistics = dialog->isStatisticsEnabled();
+    m_currentSettings.busLoad = dialog->isBusLoadEnabled();
+    m_currentSettings.changeOnly = dialog->isChangeOnlyEnabled();
+    m_currentSettings.deadband = dialog->getDeadband();
     // Since file is gotten, enable ok button.
     m_ui->okButton->setEnabled(true);
 }
+
+void ConnectDialog::setSignalPatterns(const std::vector<std::string>& include,
+                                      const std::vector<std::string>& exclude)
+{
+    m_currentSettings.signalInclude = include;
+    m_currentSettings.signalExclude = exclude;
+}
+
+void ConnectDialog::browseArchiveFile()
+{
+    const QString filename = QFileDialog::getSaveFileName(this, tr("Record raw frames to"), QString(),
+                                                          tr("Raw frame archive (*.pjcan)"));
+    if (!filename.isEmpty())
+    {
+        m_ui->archiveFileEdit->setText(filename.endsWith(".pjcan") ? filename : filename + ".pjcan");
+    }
+}
+
+void ConnectDialog::browseLogFile()
+{
+    const QString filename = QFileDialog::getOpenFileName(this, tr("Follow candump log"), QString(),
+                                                          tr("candump log (*.log)"));
+    if (!filename.isEmpty())
+    {
+        m_ui->logFileEdit->setText(filename);
+    }
+}
+
+void ConnectDialog::browseTraceFile()
+{
+    const QString filename = QFileDialog::getSaveFileName(this, tr("Write trace to"), QString(),
+                                                          tr("Chrome trace (*.json)"));
+    if (!filename.isEmpty())
+    {
+        m_ui->traceFileEdit->setText(filename.endsWith(".json") ? filename : filename + ".json");
+    }
+}
@@ -62,6 +62,7 @@
 #include <QDialog>
 
 #include "../PluginsCommonCAN/CanFrameProcessor.h"
+#include "../PluginsCommonCAN/IngestQueue.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -88,6 +89,32 @@ public:
         CanFrameProcessor::CanProtocol protocol;
         std::unordered_map<std::string, QRegularExpression> m_filter_list;
         std::unordered_set<uint64_t> m_id_filter_list;
+        std::vector<std::string> signalInclude;
+        std::vector<std::string> signalExclude;
+        std::vector<CanFrameProcessor::IsoTpChannel> isoTpChannels;
+        bool statistics = false;
+        bool busLoad = false;
+        bool changeOnly = false;
+        double deadband = 0.0;
+        bool recordArchive = false;
+        QString archiveFile;
+        int archiveSizeMb = 0;
+        int tierFactor = 0;
+        int tierLevels = 0;
+        int decoderThreads = 1;
+        bool overloadLimit = false;
+        int queueCapacity = 0;
+        IngestQueue::DropPolicy dropPolicy = IngestQueue::DROP_OLDEST;
+        std::unordered_set<uint64_t> priorityIds;
+        bool followLog = false;
+        QString logFile;
+        bool sharedRing = false;
+        QString ringName;
+        bool udpReceive = false;
+        QString udpAddress;
+        int udpPort = 0;
+        bool traceLatency = false;
+        QString traceFile;
     };
 
     explicit ConnectDialog(QWidget *parent = nullptr);
@@ -96,6 +123,8 @@ public:
     Settings settings() const;
     const std::unordered_map<std::string, QRegularExpression>& getFilterList() const { return m_currentSettings.m_filter_list;};
     const std::unordered_set<uint64_t>& getIdFilterList() const { return m_currentSettings.m_id_filter_list;};
+    // Signal patterns restored from a layout, prefilled in the database dialog
+    void setSignalPatterns(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
 
 private slots:
     void backendChanged(const QString &backend);
@@ -108,6 +137,9 @@ private:
     void revertSettings();
     void updateSettings();
     void importDatabaseLocation();
+    void browseArchiveFile();
+    void browseLogFile();
+    void browseTraceFile();
 
     Ui::ConnectDialog *m_ui = nullptr;
     Settings m_currentSettings;
@@ -25,15 +25,63 @@
 
 using namespace PJ;
 
+const double CHANGE_ONLY_MAX_HOLD_SECS = 1.0;
+const double STATISTICS_INTERVAL_SECS = 1.0;
+// Editors write a file in several steps, wait for them to finish before parsing it
+const int DBC_RELOAD_DELAY_MS = 500;
+
 DataStreamCAN::DataStreamCAN() : connect_dialog_{ new ConnectDialog() }
 {
   connect(connect_dialog_, &QDialog::accepted, this, &DataStreamCAN::connectCanInterface);
+  dbc_reload_timer_.setSingleShot(true);
+  dbc_reload_timer_.setInterval(DBC_RELOAD_DELAY_MS);
+  connect(&dbc_watcher_, &QFileSystemWatcher::fileChanged, &dbc_reload_timer_, qOverload<>(&QTimer::start));
+  connect(&dbc_reload_timer_, &QTimer::timeout, this, &DataStreamCAN::reloadCanDatabase);
 }
 
 void DataStreamCAN::connectCanInterface()
 {
   const ConnectDialog::Settings p = connect_dialog_->settings();
 
+  // Only the selected source may be left, the loop reads every source that is set
+  closeSources();
+  if (p.sharedRing)
+  {
+    frame_ring_ = std::make_unique<SharedFrameRingReader>(p.ringName);
+    if (!frame_ring_->isOpen())
+    {
+      frame_ring_.reset();
+      return;
+    }
+    startDecoding(p);
+    qDebug() << tr("Attached to shared memory frame ring %1").arg(p.ringName);
+    return;
+  }
+  if (p.udpReceive)
+  {
+    udp_receiver_ = std::make_unique<UdpFrameReceiver>(p.udpAddress, uint16_t(p.udpPort));
+    if (!udp_receiver_->isOpen())
+    {
+      udp_receiver_.reset();
+      return;
+    }
+    startDecoding(p);
+    qDebug() << tr("Receiving CAN frames on UDP port %1").arg(p.udpPort);
+    return;
+  }
+  if (p.followLog)
+  {
+    log_follower_ = std::make_unique<CanLogFollower>(p.logFile);
+    if (!log_follower_->isOpen())
+    {
+      log_follower_.reset();
+      return;
+    }
+    startDecoding(p);
+    qDebug() << tr("Following %1").arg(p.logFile);
+    return;
+  }
+
   QString errorString;
   can_interface_ = QCanBus::instance()->createDevice(p.pluginName, 
                                                      p.deviceInterfaceName,
@@ -62,11 +110,7 @@ void DataStreamCAN::connectCanInterface()
   }
   else
   {
-    std::ifstream dbc_file{ p.canDatabaseLocation.toStdString() };
-    frame_processor_ = std::make_unique<CanFrameProcessor>(dbc_file, 
-                                                           p.protocol, 
-                                                           dataMap(),
-                                                           connect_dialog_->getFilterList());
+    startDecoding(p);
 
     QVariant bitRate = can_interface_->configurationParameter(QCanBusDevice::BitRateKey);
     QString status = nullptr;
@@ -99,6 +143,105 @@ void DataStreamCAN::connectCanInterface()
   }
 }
 
+void DataStreamCAN::startDecoding(const ConnectDialog::Settings& p)
+{
+  bus_load_.reset();
+  if (p.busLoad)
+  {
+    // The bitrate comes from the connection settings, without it only frame rates are published.
+    // A followed log, a shared ring or a UDP stream has no bitrate.
+    bus_load_ = std::make_unique<BusLoadMonitor>(dataMap());
+    QVariant bitRate;
+    QVariant dataBitRate;
+    if (can_interface_)
+    {
+      bitRate = can_interface_->configurationParameter(QCanBusDevice::BitRateKey);
+      dataBitRate = can_interface_->configurationParameter(QCanBusDevice::DataBitRateKey);
+    }
+    bus_load_->setBitrate(bitRate.isValid() ? bitRate.toUInt() : 0,
+                          dataBitRate.isValid() ? dataBitRate.toUInt() : 0);
+    if (can_interface_ && !bitRate.isValid())
+    {
+      qDebug() << tr("Bitrate of %1 is not configured, bus load is not computed").arg(p.deviceInterfaceName);
+    }
+  }
+  latency_.reset();
+  trace_file_.clear();
+  if (p.traceLatency)
+  {
+    latency_ = std::make_unique<LatencyHistogram>(dataMap());
+    trace_file_ = p.traceFile;
+  }
+  SpanTracer::setEnabled(p.traceLatency && !trace_file_.isEmpty());
+  ingest_queue_.reset();
+  if (p.overloadLimit)
+  {
+    ingest_queue_ = std::make_unique<IngestQueue>(dataMap(), p.queueCapacity, p.dropPolicy, p.protocol);
+    ingest_queue_->setPriorityIds(p.priorityIds);
+  }
+  // A reload still running would target the previous processor
+  if (reload_thread_.joinable())
+  {
+    reload_thread_.join();
+  }
+  // The previous decoder stops its workers before the new one parses the database
+  frame_decoder_.reset();
+  frame_decoder_ = std::make_unique<ShardedFrameDecoder>(p.canDatabaseLocation.toStdString(),
+                                                         p.protocol,
+                                                         dataMap(),
+                                                         mutex(),
+                                                         connect_dialog_->getFilterList(),
+                                                         p.decoderThreads);
+  frame_decoder_->forEachProcessor([&](CanFrameProcessor& processor) {
+    processor.setIdFilter(connect_dialog_->getIdFilterList());
+    processor.setSignalSelection(p.signalInclude, p.signalExclude);
+    processor.setStatisticsInterval(p.statistics ? STATISTICS_INTERVAL_SECS : 0.0);
+    // Unchanged values are still stored once per hold period, otherwise constant signals
+    // would scroll out of the live view.
+    processor.setChangeOnlyMode(p.changeOnly, p.deadband, CHANGE_ONLY_MAX_HOLD_SECS);
+    processor.setDecimationTiers(p.tierFactor, p.tierLevels);
+  });
+  frame_decoder_->setIsoTpChannels(p.isoTpChannels);
+  if (!dbc_watcher_.files().isEmpty())
+  {
+    dbc_watcher_.removePaths(dbc_watcher_.files());
+  }
+  dbc_location_ = p.canDatabaseLocation;
+  dbc_watcher_.addPath(dbc_location_);
+  if (p.recordArchive)
+  {
+    const uint64_t capacity = uint64_t(p.archiveSizeMb) * 1024 * 1024 / sizeof(RawFrameRecord);
+    if (!archive_writer_.open(p.archiveFile, capacity))
+    {
+      qDebug() << tr("Raw frames are not recorded, cannot open %1").arg(p.archiveFile);
+    }
+  }
+}
+
+void DataStreamCAN::reloadCanDatabase()
+{
+  // Editors often replace the file instead of writing it, which removes it from the watcher
+  if (!dbc_watcher_.files().contains(dbc_location_) && QFile::exists(dbc_location_))
+  {
+    dbc_watcher_.addPath(dbc_location_);
+  }
+  if (!frame_decoder_)
+  {
+    return;
+  }
+  if (reload_thread_.joinable())
+  {
+    reload_thread_.join();
+  }
+  // Parsing a large DBC takes a while, decoding goes on with the current tables meanwhile
+  reload_thread_ = std::thread([this, location = dbc_location_]() {
+    if (!frame_decoder_->reloadDatabase(location.toStdString()))
+    {
+      qDebug() << tr("Could not reload CAN database %1, keeping the previous one").arg(location);
+    }
+  });
+}
+
 bool DataStreamCAN::start(QStringList*)
 {
   if (running_) {
@@ -119,6 +262,50 @@ void DataStreamCAN::shutdown()
   running_ = false;
   if (thread_.joinable())
     thread_.join();
+  if (reload_thread_.joinable())
+    reload_thread_.join();
+  archive_writer_.close();
+  if (SpanTracer::isEnabled())
+  {
+    SpanTracer::setEnabled(false);
+    QString error_string;
+    if (SpanTracer::writeChromeTrace(trace_file_, &error_string))
+    {
+      qDebug() << tr("Trace written to %1").arg(trace_file_);
+    }
+    else
+    {
+      qDebug() << tr("Cannot write trace %1: %2").arg(trace_file_).arg(error_string);
+    }
+  }
+  if (udp_receiver_)
+  {
+    const UdpFrameReceiver::Counters& counters = udp_receiver_->counters();
+    qDebug() << tr("UDP: %1 datagrams, %2 lost, %3 reordered, %4 late, %5 invalid")
+                    .arg(counters.datagrams)
+                    .arg(counters.lost_datagrams)
+                    .arg(counters.reordered_datagrams)
+                    .arg(counters.late_datagrams)
+                    .arg(counters.invalid_datagrams);
+  }
+  if (frame_ring_)
+  {
+    qDebug() << tr("Shared memory ring: %1 frames dropped by the producer").arg(frame_ring_->droppedFrames());
+  }
+  closeSources();
+}
+
+void DataStreamCAN::closeSources()
+{
+  if (can_interface_)
+  {
+    can_interface_->disconnectDevice();
+    delete can_interface_;
+    can_interface_ = nullptr;
+  }
+  log_follower_.reset();
+  frame_ring_.reset();
+  udp_receiver_.reset();
 }
 
 bool DataStreamCAN::isRunning() const
@@ -133,47 +320,169 @@ DataStreamCAN::~DataStreamCAN()
 
 bool DataStreamCAN::xmlSaveState(QDomDocument& doc, QDomElement& parent_element) const
 {
+  const ConnectDialog::Settings p = connect_dialog_->settings();
+  QDomElement elem = doc.createElement("signal_selection");
+  elem.setAttribute("include", QString::fromStdString(NameMatcher::joinPatterns(p.signalInclude)));
+  elem.setAttribute("exclude", QString::fromStdString(NameMatcher::joinPatterns(p.signalExclude)));
+  parent_element.appendChild(elem);
   return true;
 }
 
 bool DataStreamCAN::xmlLoadState(const QDomElement& parent_element)
 {
+  QDomElement elem = parent_element.firstChildElement("signal_selection");
+  if (!elem.isNull())
+  {
+    connect_dialog_->setSignalPatterns(NameMatcher::splitPatterns(elem.attribute("include").toStdString()),
+                                       NameMatcher::splitPatterns(elem.attribute("exclude").toStdString()));
+  }
   return true;
 }
 
 void DataStreamCAN::pushSingleCycle()
 {
+  if (frame_decoder_->applyReloadedDatabase())
+  {
+    qDebug() << tr("Reloaded CAN database %1").arg(dbc_location_);
+  }
+  readFrames();
+
+  // Decoding runs without the lock, the GUI thread only waits for the merge of the decoded samples
+  {
+    TraceSpan decode_span("decode");
+    frame_decoder_->decodeQueued();
+  }
+  TraceSpan lock_span("lock");
+  std::lock_guard<std::mutex> lock(mutex());
+  lock_span.end();
+  frame_decoder_->mergeDecoded();
+  if (latency_)
+  {
+    latency_->endCycle();
+  }
+}
+
+void DataStreamCAN::readFrames()
+{
+  // Time waiting for the GUI thread, which holds the lock while it reads the series. The monitors
+  // publish into the data map while the frames are read.
+  TraceSpan lock_span("lock");
   std::lock_guard<std::mutex> lock(mutex());
+  lock_span.end();
 
-  // Since readAllFrames is introduced in Qt5.12, reading using for
-  auto n_frames = can_interface_->framesAvailable();
-  for (int i = 0; i < n_frames; i++)
+  // Every frame is archived and counted in the bus load before filtering, so that the session can
+  // be decoded again later
+  auto ingestFrame = [this](uint32_t frame_id, const uint8_t* data_ptr, size_t data_len, uint8_t flags,
+                            double timestamp) {
+    if (archive_writer_.isOpen())
+    {
+      archive_writer_.append(timestamp, frame_id, flags, data_ptr, data_len);
+    }
+    if (bus_load_)
+    {
+      bus_load_->addFrame(timestamp, frame_id, flags, data_len);
+    }
+    if (latency_)
+    {
+      latency_->addFrame(timestamp);
+    }
+    // Remote requests and error frames are archived and take bus time, but carry no signals
+    if (flags & (RawFrameRecord::REMOTE_REQUEST | RawFrameRecord::ERROR_FRAME))
+    {
+      return;
+    }
+    if (ingest_queue_)
+    {
+      ingest_queue_->push(frame_id, data_ptr, data_len, flags, timestamp);
+    }
+    else
+    {
+      frame_decoder_->queueFrame(frame_id, data_ptr, data_len, flags, timestamp);
+    }
+  };
+
+  TraceSpan read_span("read");
+  if (can_interface_)
   {
-    auto frame = can_interface_->readFrame();
-    double timestamp = frame.timeStamp().seconds() + frame.timeStamp().microSeconds() * 1e-6;
-    // apply id filter only when filter list is not empty
-    if(connect_dialog_->getIdFilterList().find(frame.frameId()) == connect_dialog_->getIdFilterList().end() &&
-       !connect_dialog_->getIdFilterList().empty())
+    // Since readAllFrames is introduced in Qt5.12, reading using for
+    auto n_frames = can_interface_->framesAvailable();
+    for (int i = 0; i < n_frames; i++)
     {
-      continue;
+      auto frame = can_interface_->readFrame();
+      double timestamp = frame.timeStamp().seconds() + frame.timeStamp().microSeconds() * 1e-6;
+      uint8_t flags = 0;
+      flags |= frame.hasExtendedFrameFormat() ? RawFrameRecord::EXTENDED_ID : 0;
+      flags |= frame.hasFlexibleDataRateFormat() ? RawFrameRecord::FLEXIBLE_DATA_RATE : 0;
+      flags |= frame.hasBitrateSwitch() ? RawFrameRecord::BITRATE_SWITCH : 0;
+      flags |= frame.frameType() == QCanBusFrame::RemoteRequestFrame ? RawFrameRecord::REMOTE_REQUEST : 0;
+      flags |= frame.frameType() == QCanBusFrame::ErrorFrame ? RawFrameRecord::ERROR_FRAME : 0;
+      ingestFrame(frame.frameId(), (const uint8_t*)frame.payload().constData(), frame.payload().size(), flags,
+                  timestamp);
     }
-    frame_processor_->ProcessCanFrame(frame.frameId(), (const uint8_t*)frame.payload().data(), 8, timestamp);
+  }
+  if (log_follower_)
+  {
+    // Only the lines appended since the previous cycle are parsed, at most a read-ahead of
+    // CanLogFollower::DEFAULT_READ_BYTES. The rest waits in the file, where nothing is lost.
+    log_follower_->readAppended(frame_decoder_->isExtendedId(), [&](const RawFrameRecord& record) {
+      ingestFrame(record.frame_id, record.data, record.data_len, record.flags, record.timestamp_secs);
+    });
+  }
+  if (frame_ring_)
+  {
+    // Records are read in place in the shared memory, the slots are handed back to the producer once
+    // they are queued
+    frame_ring_->readAvailable([&](const RawFrameRecord& record) {
+      ingestFrame(record.frame_id, record.data, record.data_len, record.flags, record.timestamp_secs);
+    });
+  }
+  if (udp_receiver_)
+  {
+    // Datagrams are read in batches and released in sequence order
+    udp_receiver_->readAvailable([&](const RawFrameRecord& record) {
+      ingestFrame(record.frame_id, record.data, record.data_len, record.flags, record.timestamp_secs);
+    });
+  }
+  read_span.end();
+  // The sources are emptied every cycle, frames beyond the queue capacity are dropped here and counted
+  // with what the sources lost themselves
+  if (ingest_queue_)
+  {
+    if (frame_ring_)
+    {
+      ingest_queue_->setSourceLoss("ring_dropped_frames", frame_ring_->droppedFrames());
+    }
+    if (udp_receiver_)
+    {
+      ingest_queue_->setSourceLoss("udp_lost_datagrams", udp_receiver_->counters().lost_datagrams);
+      ingest_queue_->setSourceLoss("udp_late_datagrams", udp_receiver_->counters().late_datagrams);
+    }
+    ingest_queue_->drain([this](const RawFrameRecord& record) {
+      frame_decoder_->queueFrame(record.frame_id, record.data, record.data_len, record.flags,
+                                 record.timestamp_secs);
+    });
   }
 }
 
 void DataStreamCAN::loop()
 {
   // Block until both are initalized
-  while (can_interface_ == nullptr || frame_processor_ == nullptr)
+  while ((can_interface_ == nullptr && log_follower_ == nullptr && frame_ring_ == nullptr && udp_receiver_ == nullptr) ||
+         frame_decoder_ == nullptr)
   {
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
   }
   running_ = true;
+  SpanTracer::setThreadName("streamer");
   while (running_)
   {
     auto prev = std::chrono::high_resolution_clock::now();
     pushSingleCycle();
-    emit dataReceived();
+    {
+      TraceSpan span("emit dataReceived");
+      emit dataReceived();
+    }
+    TraceSpan sleep_span("sleep");
     std::this_thread::sleep_until(prev + std::chrono::milliseconds(10));
   }
 }
@@ -3,12 +3,23 @@
 #include <QtPlugin>
 #include <QCanBus>
 #include <QCanBusFrame>
+#include <QFileSystemWatcher>
+#include <QTimer>
 #include <thread>
 
 #include <PlotJuggler/datastreamer_base.h>
 
 #include "connectdialog.h"
+#include "../PluginsCommonCAN/BusLoadMonitor.h"
 #include "../PluginsCommonCAN/CanFrameProcessor.h"
+#include "../PluginsCommonCAN/CanLogFollower.h"
+#include "../PluginsCommonCAN/IngestQueue.h"
+#include "../PluginsCommonCAN/LatencyHistogram.h"
+#include "../PluginsCommonCAN/RawFrameArchive.h"
+#include "../PluginsCommonCAN/ShardedFrameDecoder.h"
+#include "../PluginsCommonCAN/SharedFrameRing.h"
+#include "../PluginsCommonCAN/SpanTracer.h"
+#include "../PluginsCommonCAN/UdpFrameReceiver.h"
 
 const uint64_t EXTENDED_IDENTIFIER = 2147483648;
 const uint8_t MAX_DATA_SIZE = 64;
@@ -41,16 +52,40 @@ public:
 
 private slots:
   void connectCanInterface();
+  void reloadCanDatabase();
   uint64_t getId(const uint64_t frame_id);
 
 private:
   ConnectDialog *connect_dialog_;
   QCanBusDevice *can_interface_ = nullptr;
-  std::unique_ptr<CanFrameProcessor> frame_processor_;
+  // Source of the frames instead of can_interface_ when following a log
+  std::unique_ptr<CanLogFollower> log_follower_;
+  // Source of the frames instead of can_interface_ when attached to a producer on this machine
+  std::unique_ptr<SharedFrameRingReader> frame_ring_;
+  // Source of the frames instead of can_interface_ when receiving them from a remote logger
+  std::unique_ptr<UdpFrameReceiver> udp_receiver_;
+  std::unique_ptr<ShardedFrameDecoder> frame_decoder_;
+  RawFrameArchiveWriter archive_writer_;
+  std::unique_ptr<BusLoadMonitor> bus_load_;
+  std::unique_ptr<IngestQueue> ingest_queue_;
+  // Latency tracing, the spans are written to trace_file_ on shutdown
+  std::unique_ptr<LatencyHistogram> latency_;
+  QString trace_file_;
+  // DBC hot reload, the decode tables are built on reload_thread_ and adopted between cycles
+  QFileSystemWatcher dbc_watcher_;
+  QTimer dbc_reload_timer_;
+  QString dbc_location_;
+  std::thread reload_thread_;
 
   std::thread thread_;
   bool running_;
   void loop();
   void pushSingleCycle();
+  // Reads the frames of the cycle and queues them for decoding, under the lock of the data map
+  void readFrames();
+  // Creates the decoder and the monitors for a connected source
+  void startDecoding(const ConnectDialog::Settings& p);
+  // Disconnects and releases every source of frames, call while the loop is not running
+  void closeSources();
 };
 
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "BusLoadMonitor.h"
+
+namespace
+{
+// Bits after the CRC field: CRC delimiter (classic only), ACK slot and delimiter, EOF, interframe space
+const uint32_t CLASSIC_TAIL_BITS = 13;
+const uint32_t FD_TAIL_BITS = 12;
+
+size_t stepSlot(int64_t step_index, size_t window_steps)
+{
+  const int64_t slot = step_index % int64_t(window_steps);
+  return size_t(slot < 0 ? slot + int64_t(window_steps) : slot);
+}
+}  // namespace
+
+BusLoadMonitor::BusLoadMonitor(PJ::PlotDataMapRef& data_map, double window_secs, size_t window_steps)
+  : data_map_{ data_map }
+  , step_secs_{ window_secs / window_steps }
+  , window_steps_{ window_steps }
+  , busy_secs_(window_steps, 0.0)
+  , frames_(window_steps, 0)
+{
+}
+
+void BusLoadMonitor::setBitrate(uint32_t nominal_bitrate, uint32_t data_bitrate)
+{
+  nominal_bitrate_ = nominal_bitrate;
+  data_bitrate_ = data_bitrate;
+}
+
+void BusLoadMonitor::frameBits(uint8_t flags, size_t data_len, uint32_t& nominal_bits, uint32_t& data_bits)
+{
+  // Worst case stuffing: one stuff bit every four bits of the stuffed part, after the first one
+  const bool extended = flags & RawFrameRecord::EXTENDED_ID;
+  if (flags & RawFrameRecord::FLEXIBLE_DATA_RATE)
+  {
+    const uint32_t arbitration = extended ? 36 : 17;  // SOF up to BRS
+    const uint32_t control = 5 + 8 * uint32_t(std::min<size_t>(data_len, 64));  // ESI, DLC and data
+    const uint32_t crc = data_len <= 16 ? 17 : 21;
+    const uint32_t arbitration_stuff = (arbitration - 1) / 4;
+    const uint32_t control_stuff = (arbitration + control - 1) / 4 - arbitration_stuff;
+    // Stuff count and CRC with their fixed stuff bits, then the CRC delimiter
+    const uint32_t crc_field = 4 + crc + (4 + crc + 3) / 4 + 1;
+    nominal_bits = arbitration + arbitration_stuff + FD_TAIL_BITS;
+    data_bits = control + control_stuff + crc_field;
+    if (!(flags & RawFrameRecord::BITRATE_SWITCH))
+    {
+      nominal_bits += data_bits;
+      data_bits = 0;
+    }
+  }
+  else
+  {
+    const uint32_t payload = (flags & RawFrameRecord::REMOTE_REQUEST) ? 0 : 8 * uint32_t(std::min<size_t>(data_len, 8));
+    // SOF up to the end of the CRC
+    const uint32_t stuffed = (extended ? 54 : 34) + payload;
+    nominal_bits = stuffed + (stuffed - 1) / 4 + CLASSIC_TAIL_BITS;
+    data_bits = 0;
+  }
+}
+
+void BusLoadMonitor::addFrame(double timestamp_secs, uint32_t frame_id, uint8_t flags, size_t data_len)
+{
+  if (flags & RawFrameRecord::ERROR_FRAME)
+  {
+    return;
+  }
+  const int64_t step_index = int64_t(std::floor(timestamp_secs / step_secs_));
+  if (!started_)
+  {
+    started_ = true;
+    current_step_ = step_index;
+    steps_seen_ = 1;
+    load_plot_ = getPlot("can_bus/load_percent");
+    rate_plot_ = getPlot("can_bus/frames_per_sec");
+  }
+  else if (step_index > current_step_)
+  {
+    advanceTo(step_index);
+  }
+  // Frames slightly out of order are counted in the current step
+  const size_t slot = stepSlot(current_step_, window_steps_);
+
+  if (nominal_bitrate_ > 0)
+  {
+    uint32_t nominal_bits = 0;
+    uint32_t data_bits = 0;
+    frameBits(flags, data_len, nominal_bits, data_bits);
+    busy_secs_[slot] += double(nominal_bits) / nominal_bitrate_ +
+                        double(data_bits) / (data_bitrate_ > 0 ? data_bitrate_ : nominal_bitrate_);
+  }
+  frames_[slot]++;
+
+  auto [id_it, inserted] = ids_.try_emplace(frame_id);
+  IdState& id = id_it->second;
+  if (inserted)
+  {
+    char id_str[16];
+    const bool extended = (flags & RawFrameRecord::EXTENDED_ID) || frame_id > 0x7FF;
+    snprintf(id_str, sizeof(id_str), extended ? "0x%08X" : "0x%03X", frame_id);
+    id.rate_plot = getPlot(std::string("can_bus/ids/") + id_str + "/frames_per_sec");
+    id.jitter_plot = getPlot(std::string("can_bus/ids/") + id_str + "/jitter_ms");
+    id.steps.resize(window_steps_);
+  }
+  else
+  {
+    const double interval = timestamp_secs - id.last_timestamp;
+    Step& step = id.steps[slot];
+    step.intervals++;
+    step.interval_sum += interval;
+    step.interval_sum_sq += interval * interval;
+  }
+  id.steps[slot].frames++;
+  id.last_timestamp = timestamp_secs;
+}
+
+void BusLoadMonitor::advanceTo(int64_t step_index)
+{
+  while (current_step_ < step_index)
+  {
+    publish((current_step_ + 1) * step_secs_);
+    uint64_t window_frames = 0;
+    for (uint64_t frames : frames_)
+    {
+      window_frames += frames;
+    }
+    // After a gap longer than the window there is nothing left to expire, jump to the new step
+    if (window_frames == 0)
+    {
+      current_step_ = step_index - 1;
+    }
+    current_step_++;
+    steps_seen_ = std::min(steps_seen_ + 1, window_steps_);
+    // The new step replaces the oldest one of the window
+    const size_t slot = stepSlot(current_step_, window_steps_);
+    busy_secs_[slot] = 0.0;
+    frames_[slot] = 0;
+    for (auto& [frame_id, id] : ids_)
+    {
+      id.steps[slot] = Step();
+    }
+  }
+}
+
+void BusLoadMonitor::publish(double timestamp_secs)
+{
+  // The window is shorter than nominal until enough steps have been seen
+  const double window_secs = steps_seen_ * step_secs_;
+  double busy_secs = 0.0;
+  uint64_t frames = 0;
+  for (size_t i = 0; i < window_steps_; i++)
+  {
+    busy_secs += busy_secs_[i];
+    frames += frames_[i];
+  }
+  if (nominal_bitrate_ > 0)
+  {
+    load_plot_->pushBack({ timestamp_secs, 100.0 * busy_secs / window_secs });
+  }
+  rate_plot_->pushBack({ timestamp_secs, frames / window_secs });
+
+  for (auto& [frame_id, id] : ids_)
+  {
+    Step window;
+    for (const Step& step : id.steps)
+    {
+      window.frames += step.frames;
+      window.intervals += step.intervals;
+      window.interval_sum += step.interval_sum;
+      window.interval_sum_sq += step.interval_sum_sq;
+    }
+    // Ids that went silent get a last zero rate sample and are then skipped
+    if (window.frames == 0 && id.window.frames == 0)
+    {
+      continue;
+    }
+    id.rate_plot->pushBack({ timestamp_secs, window.frames / window_secs });
+    if (window.intervals >= 2)
+    {
+      // Standard deviation of the inter-arrival time
+      const double mean = window.interval_sum / window.intervals;
+      const double variance = std::max(0.0, window.interval_sum_sq / window.intervals - mean * mean);
+      id.jitter_plot->pushBack({ timestamp_secs, 1e3 * std::sqrt(variance) });
+    }
+    id.window = window;
+  }
+}
+
+PJ::PlotData* BusLoadMonitor::getPlot(const std::string& name)
+{
+  auto plot_it = data_map_.numeric.find(name);
+  if (plot_it == data_map_.numeric.end())
+  {
+    plot_it = data_map_.addNumeric(name);
+  }
+  return &plot_it->second;
+}
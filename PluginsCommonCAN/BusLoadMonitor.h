@@ -0,0 +1,70 @@
+#ifndef BUS_LOAD_MONITOR_H_
+#define BUS_LOAD_MONITOR_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <PlotJuggler/plotdata.h>
+
+#include "RawFrameArchive.h"
+
+// Bus utilization and per-id frame rate and inter-arrival jitter over a rolling window, published
+// as can_bus/... series. The window is split in steps, each frame only updates the running sums of
+// the current step and the series are published once per step, so the cost per frame is constant.
+class BusLoadMonitor
+{
+public:
+  BusLoadMonitor(PJ::PlotDataMapRef& data_map, double window_secs = 1.0, size_t window_steps = 10);
+
+  // Nominal and data phase bitrate in bit/s. Without a nominal bitrate the load is not published,
+  // without a data bitrate the data phase of CAN FD frames is timed at the nominal bitrate.
+  void setBitrate(uint32_t nominal_bitrate, uint32_t data_bitrate = 0);
+
+  // flags are RawFrameRecord::Flags, frames have to arrive in time order
+  void addFrame(double timestamp_secs, uint32_t frame_id, uint8_t flags, size_t data_len);
+
+  // Worst case length in bits of a frame including stuff bits and interframe space, split in the bits
+  // sent at the nominal and at the data bitrate (non zero only for CAN FD frames with bitrate switch)
+  static void frameBits(uint8_t flags, size_t data_len, uint32_t& nominal_bits, uint32_t& data_bits);
+
+private:
+  struct Step
+  {
+    uint64_t frames = 0;
+    uint64_t intervals = 0;
+    double interval_sum = 0.0;
+    double interval_sum_sq = 0.0;
+  };
+  struct IdState
+  {
+    PJ::PlotData* rate_plot = nullptr;
+    PJ::PlotData* jitter_plot = nullptr;
+    double last_timestamp = 0.0;
+    std::vector<Step> steps;
+    Step window;  // sum of the steps at the last publication
+  };
+
+  void advanceTo(int64_t step_index);
+  void publish(double timestamp_secs);
+  PJ::PlotData* getPlot(const std::string& name);
+
+  PJ::PlotDataMapRef& data_map_;
+  double step_secs_;
+  size_t window_steps_;
+  uint32_t nominal_bitrate_ = 0;
+  uint32_t data_bitrate_ = 0;
+
+  int64_t current_step_ = 0;
+  size_t steps_seen_ = 0;  // steps the window covers until it is full
+  bool started_ = false;
+  std::vector<double> busy_secs_;
+  std::vector<uint64_t> frames_;
+  double window_busy_secs_ = 0.0;
+  uint64_t window_frames_ = 0;
+  std::unordered_map<uint32_t, IdState> ids_;
+
+  PJ::PlotData* load_plot_ = nullptr;
+  PJ::PlotData* rate_plot_ = nullptr;
+};
+
+#endif  // BUS_LOAD_MONITOR_H_
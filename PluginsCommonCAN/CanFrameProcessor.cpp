@@ -1,8 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <variant>
+
 #include "CanFrameProcessor.h"
 #include "N2kMsg/GenericFastPacket.h"
 
 const uint64_t EXTENDED_IDENTIFIER = 0x80000000UL;
 const uint8_t MAX_DATA_SIZE = 64;
+const size_t TOP_UNKNOWN_IDS = 10;
+// Frames per id decoded together in batch mode
+const size_t BATCH_SIZE = 1024;
+// ISO-TP PDUs are at most 4095 bytes on classic CAN, CAN FD first frames may announce up to 4 GiB
+const size_t ISOTP_CLASSIC_MAX_PDU = 4095;
+const size_t ISOTP_MAX_PDU = 1 << 20;
+// dbcppp reads whole 64 bit words, the PDU buffer is padded so that it never reads past it
+const size_t ISOTP_DECODE_PADDING = 8;
+// Bytes of a PDU published as raw series when the database has no message for its id
+const size_t ISOTP_RAW_BYTES = 16;
+
+namespace
+{
+// Position of an integer signal in the payload read as a single 64 bit word
+struct BatchSignalLayout
+{
+  bool big_endian;
+  uint32_t shift;  // of the least significant bit
+  uint32_t size;
+  bool is_signed;
+  double factor;
+  double offset;
+};
+
+// Byte after the last one a signal occupies
+size_t signalEndByte(const dbcppp::ISignal& sig)
+{
+  if (sig.ByteOrder() == dbcppp::ISignal::EByteOrder::LittleEndian)
+  {
+    return (sig.StartBit() + sig.BitSize() + 7) / 8;
+  }
+  // Big endian signals start at their most significant bit and continue in the following bytes
+  const uint64_t first_byte_bits = sig.StartBit() % 8 + 1;
+  const uint64_t remaining_bits = sig.BitSize() > first_byte_bits ? sig.BitSize() - first_byte_bits : 0;
+  return sig.StartBit() / 8 + 1 + (remaining_bits + 7) / 8;
+}
+
+// Byte after the last one read when decoding signals of msg, the multiplexer included
+size_t decodedEndByte(const dbcppp::IMessage& msg, const std::vector<const dbcppp::ISignal*>& signals_to_decode)
+{
+  size_t end_byte = msg.MuxSignal() ? signalEndByte(*msg.MuxSignal()) : 0;
+  for (const dbcppp::ISignal* sig : signals_to_decode)
+  {
+    end_byte = std::max(end_byte, signalEndByte(*sig));
+  }
+  return end_byte;
+}
+
+// False for signals that do not fit in the first 8 bytes or are not integers, they are decoded by dbcppp
+bool makeBatchLayout(const dbcppp::ISignal& sig, BatchSignalLayout& layout)
+{
+  const uint64_t size = sig.BitSize();
+  if (sig.ExtendedValueType() != dbcppp::ISignal::EExtendedValueType::Integer || size == 0 || size > 64)
+  {
+    return false;
+  }
+  layout.size = uint32_t(size);
+  layout.big_endian = sig.ByteOrder() == dbcppp::ISignal::EByteOrder::BigEndian;
+  if (!layout.big_endian)
+  {
+    if (sig.StartBit() + size > 64)
+    {
+      return false;
+    }
+    layout.shift = uint32_t(sig.StartBit());
+  }
+  else
+  {
+    if (sig.StartBit() >= 64)
+    {
+      return false;
+    }
+    // The start bit is the most significant one, in the sawtooth numbering of Motorola signals
+    const uint64_t msb = (7 - sig.StartBit() / 8) * 8 + sig.StartBit() % 8;
+    if (msb + 1 < size)
+    {
+      return false;
+    }
+    layout.shift = uint32_t(msb + 1 - size);
+  }
+  layout.is_signed = sig.ValueType() == dbcppp::ISignal::EValueType::Signed;
+  layout.factor = sig.Factor();
+  layout.offset = sig.Offset();
+  return true;
+}
+
+// Signals of up to 31 bits (32 if signed) are extracted through 32 bit integers, which vector units
+// convert to double directly. The loops are branch free, so that the compiler vectorizes them (AVX2,
+// NEON) where the target allows it, and they stay tight scalar loops otherwise.
+template <bool MOTOROLA_ORDER>
+void extractNarrowSignal(const uint64_t* payloads, size_t count, double* values, uint32_t shift, uint64_t mask,
+                         uint32_t sign_shift, double factor, double offset)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    const uint64_t word = MOTOROLA_ORDER ? __builtin_bswap64(payloads[i]) : payloads[i];
+    // Sign extension through an arithmetic shift, sign_shift is 0 for unsigned signals
+    const int32_t raw = int32_t(uint32_t((word >> shift) & mask) << sign_shift) >> sign_shift;
+    values[i] = double(raw) * factor + offset;
+  }
+}
+
+template <bool MOTOROLA_ORDER>
+void extractWideSignal(const uint64_t* payloads, size_t count, double* values, uint32_t shift, uint64_t mask,
+                       uint32_t sign_shift, bool is_signed, double factor, double offset)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    const uint64_t word = MOTOROLA_ORDER ? __builtin_bswap64(payloads[i]) : payloads[i];
+    const uint64_t raw = (word >> shift) & mask;
+    const double value = is_signed ? double(int64_t(raw << sign_shift) >> sign_shift) : double(raw);
+    values[i] = value * factor + offset;
+  }
+}
+
+// One pass over the payloads of a batch
+void extractSignal(const BatchSignalLayout& layout, const uint64_t* payloads, size_t count, double* values)
+{
+  const uint64_t mask = layout.size == 64 ? ~uint64_t(0) : (uint64_t(1) << layout.size) - 1;
+  if (layout.size < 32 || (layout.size == 32 && layout.is_signed))
+  {
+    const uint32_t sign_shift = layout.is_signed ? 32 - layout.size : 0;
+    if (layout.big_endian)
+    {
+      extractNarrowSignal<true>(payloads, count, values, layout.shift, mask, sign_shift, layout.factor, layout.offset);
+    }
+    else
+    {
+      extractNarrowSignal<false>(payloads, count, values, layout.shift, mask, sign_shift, layout.factor, layout.offset);
+    }
+  }
+  else
+  {
+    const uint32_t sign_shift = 64 - layout.size;
+    if (layout.big_endian)
+    {
+      extractWideSignal<true>(payloads, count, values, layout.shift, mask, sign_shift, layout.is_signed,
+                              layout.factor, layout.offset);
+    }
+    else
+    {
+      extractWideSignal<false>(payloads, count, values, layout.shift, mask, sign_shift, layout.is_signed,
+                               layout.factor, layout.offset);
+    }
+  }
+}
+}  // namespace
+
+template <typename NameFunc>
+CanFrameProcessor::SeriesState* CanFrameProcessor::internedSeries(uint64_t key, const dbcppp::ISignal& sig,
+                                                                  NameFunc make_name)
+{
+  auto it = series_handles_.find(key);
+  if (it == series_handles_.end())
+  {
+    const std::string name = make_name();
+    getSeries(name, &sig);
+    // Elements of series_ keep their address, the handle stays valid
+    it = series_handles_.emplace(key, &series_.at(name)).first;
+  }
+  return it->second->plot ? it->second : nullptr;
+}
+
+uint64_t CanFrameProcessor::n2kSeriesKey(const uint32_t frame_id, size_t signal_index) const
+{
+  // The same fields as the series name: PGN, destination (PDU1 only) and source address
+  const uint64_t pgn = PGN_FROM_FRAME_ID(frame_id);
+  const uint64_t destination = ((frame_id >> 16) & 0xFF) < 240 ? (frame_id >> 8) & 0xFF : 0;
+  const uint64_t source = frame_id & 0xFF;
+  return (((pgn << 16) | (destination << 8) | source) << 16) | signal_index;
+}
 
 CanFrameProcessor::CanFrameProcessor(std::ifstream& dbc_file, 
                                      CanProtocol protocol, 
@@ -10,49 +186,109 @@ CanFrameProcessor::CanFrameProcessor(std::ifstream& dbc_file,
                                      const std::unordered_map<std::string, QRegularExpression>& filter_list)
   : protocol_{ protocol }, data_map_{ data_map }
 {
-  can_network_ = dbcppp::INetwork::LoadDBCFromIs(dbc_file);
-  messages_.clear();
-  auto isFound = [&filter_list](const std::string& name) 
-  { 
-    for(const auto&[key, re] : filter_list)
-    {
-      if(re.match(name.c_str()).hasMatch()){
-        return true;
-      }
-    }
-    return false;
-  };
-  
-  for (const dbcppp::IMessage& msg : can_network_->Messages())
+  std::vector<std::string> patterns;
+  for (const auto& [pattern, re] : filter_list)
   {
-    if (protocol_ == CanProtocol::RAW) {
-      // When protocol is raw, use can_id from the dbc as the key for the messages
-      if(!is_extended_id_)
-      {
-        is_extended_id_ = msg.Id() & EXTENDED_IDENTIFIER;
-      }
-      
-      if(isFound(msg.Name()) && !filter_list.empty() ||
-         filter_list.empty())
+    patterns.push_back(pattern);
+  }
+  name_matcher_ = NameMatcher(patterns);
+  adoptDatabase(*buildTables(dbc_file));
+}
+
+std::unique_ptr<CanFrameProcessor::DecodeTables> CanFrameProcessor::buildTables(std::ifstream& dbc_file) const
+{
+  auto tables = std::make_unique<DecodeTables>();
+  tables->network = dbcppp::INetwork::LoadDBCFromIs(dbc_file);
+  if (!tables->network)
+  {
+    return tables;
+  }
+  for (const dbcppp::IMessage& msg : tables->network->Messages())
+  {
+    // When protocol is raw, use can_id from the dbc as the key for the messages, otherwise the PGN
+    uint64_t key;
+    if (protocol_ == CanProtocol::RAW)
+    {
+      if (!tables->is_extended_id)
       {
-        //qDebug() << "found CAN " << msg.Name().c_str() << " with ID " << getId(msg.Id());
-        messages_.insert({getId(msg.Id()), &msg});
+        tables->is_extended_id = msg.Id() & EXTENDED_IDENTIFIER;
       }
-      
+      key = getId(msg.Id());
     }
-    else {
-      // When protocol is not raw, use PGN as the key for the messages_
-      messages_.insert(std::make_pair(PGN_FROM_FRAME_ID(msg.Id()), &msg));
-      // For N2kMsgFast, MessageSize is certainly larger than 8 bytes
-      if (protocol_ == CanProtocol::NMEA2K)
+    else
+    {
+      key = PGN_FROM_FRAME_ID(msg.Id());
+    }
+    // A matching message decodes all of its signals, otherwise only the matching signals are decoded
+    MessageEntry entry{ &msg, {} };
+    const bool message_matches = name_matcher_.empty() || name_matcher_.matches(msg.Name());
+    for (const dbcppp::ISignal& sig : msg.Signals())
+    {
+      if ((message_matches || name_matcher_.matches(sig.Name())) && isSignalSelected(msg, sig))
       {
-        if (msg.MessageSize() > 8)
-        {
-          fast_packet_pgns_set_.insert(PGN_FROM_FRAME_ID(msg.Id()));
-        }
+        entry.decoded_signals.push_back(&sig);
       }
     }
+    if (entry.decoded_signals.empty())
+    {
+      continue;
+    }
+    // For N2kMsgFast, MessageSize is certainly larger than 8 bytes
+    entry.fast_packet = protocol_ == CanProtocol::NMEA2K && msg.MessageSize() > 8;
+    entry.end_byte = decodedEndByte(msg, entry.decoded_signals);
+    tables->messages.insert(uint32_t(key), std::move(entry));
+  }
+  return tables;
+}
+
+bool CanFrameProcessor::isSignalSelected(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig) const
+{
+  if (signal_include_.empty() && signal_exclude_.empty())
+  {
+    return true;
   }
+  const std::string path = msg.Name() + "/" + sig.Name();
+  return (signal_include_.empty() || signal_include_.matches(path)) && !signal_exclude_.matches(path);
+}
+
+void CanFrameProcessor::setSignalSelection(const std::vector<std::string>& include,
+                                           const std::vector<std::string>& exclude)
+{
+  signal_include_ = NameMatcher(include);
+  signal_exclude_ = NameMatcher(exclude);
+  // Narrow the signal lists of the current tables, messages without selected signals are dropped
+  // Signal indexes change
+  series_handles_.clear();
+  messages_.eraseIf([this](uint32_t, MessageEntry& entry) {
+    auto& decoded_signals = entry.decoded_signals;
+    decoded_signals.erase(std::remove_if(decoded_signals.begin(), decoded_signals.end(),
+                                         [&](const dbcppp::ISignal* sig) {
+                                           return !isSignalSelected(*entry.msg, *sig);
+                                         }),
+                          decoded_signals.end());
+    entry.end_byte = decodedEndByte(*entry.msg, decoded_signals);
+    return decoded_signals.empty();
+  });
+}
+
+void CanFrameProcessor::adoptDatabase(DecodeTables& tables)
+{
+  // Timings are keyed by the messages of the previous network, which is released below
+  message_timings_.clear();
+  series_handles_.clear();
+  messages_ = std::move(tables.messages);
+  is_extended_id_ = tables.is_extended_id;
+  can_network_ = std::move(tables.network);
+}
+
+std::unique_ptr<CanFrameProcessor::DecodeTables> CanFrameProcessor::parseDatabase(std::ifstream& dbc_file) const
+{
+  std::unique_ptr<DecodeTables> tables = buildTables(dbc_file);
+  if (!tables->network)
+  {
+    return nullptr;
+  }
+  return tables;
 }
 
 bool CanFrameProcessor::ProcessCanFrame(const uint32_t frame_id, const uint8_t* payload_ptr, const size_t data_len,
@@ -60,23 +296,38 @@ bool CanFrameProcessor::ProcessCanFrame(const uint32_t frame_id, const uint8_t*
 {
   if (can_network_)
   {
+    counters_.frames_in++;
+    if (!passesIdFilter(frame_id))
+    {
+      counters_.frames_filtered++;
+      return false;
+    }
+    bool processed = false;
     switch (protocol_)
     {
       case CanProtocol::RAW:
       {
-        return ProcessCanFrameRaw(frame_id, payload_ptr, data_len, timestamp_secs);
+        processed = ProcessCanFrameRaw(frame_id, payload_ptr, data_len, timestamp_secs);
+        break;
       }
       case CanProtocol::NMEA2K:
       {
-        return ProcessCanFrameN2k(frame_id, payload_ptr, data_len, timestamp_secs);
+        processed = ProcessCanFrameN2k(frame_id, payload_ptr, data_len, timestamp_secs);
+        break;
       }
       case CanProtocol::J1939:
       {
-        return ProcessCanFrameJ1939(frame_id, payload_ptr, data_len, timestamp_secs);
+        processed = ProcessCanFrameJ1939(frame_id, payload_ptr, data_len, timestamp_secs);
+        break;
       }
       default:
-        return false;
+        break;
+    }
+    if (statistics_interval_ > 0.0 && timestamp_secs - last_statistics_ts_ >= statistics_interval_)
+    {
+      publishStatistics(timestamp_secs);
     }
+    return processed;
   }
   else
   {
@@ -84,149 +335,908 @@ bool CanFrameProcessor::ProcessCanFrame(const uint32_t frame_id, const uint8_t*
   }
 }
 
+void CanFrameProcessor::queueCanFrame(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
+                                      const double timestamp_secs)
+{
+  if (!can_network_)
+  {
+    return;
+  }
+  // ISO-TP frames are reassembled in order, they are never batched
+  const bool isotp_frame = !isotp_sessions_.empty() && isotp_sessions_.count(frame_id);
+  if (protocol_ != CanProtocol::RAW || data_len > 8 || isotp_frame)
+  {
+    // Queued frames of the id go first, so that its series stay in time order
+    auto batch_it = batches_.find(frame_id);
+    if (batch_it != batches_.end() && !batch_it->second.timestamps.empty())
+    {
+      decodeBatch(frame_id, batch_it->second);
+    }
+    ProcessCanFrame(frame_id, data_ptr, data_len, timestamp_secs);
+    return;
+  }
+  counters_.frames_in++;
+  if (!passesIdFilter(frame_id))
+  {
+    counters_.frames_filtered++;
+    return;
+  }
+  // Payloads are kept as little endian words, zero padded to 8 bytes
+  uint8_t bytes[8] = {};
+  memcpy(bytes, data_ptr, data_len);
+  uint64_t payload = 0;
+  for (int i = 7; i >= 0; i--)
+  {
+    payload = (payload << 8) | bytes[i];
+  }
+  FrameBatch& batch = batches_[frame_id];
+  batch.payloads.push_back(payload);
+  batch.timestamps.push_back(timestamp_secs);
+  if (batch.timestamps.size() >= BATCH_SIZE)
+  {
+    decodeBatch(frame_id, batch);
+  }
+}
+
+void CanFrameProcessor::flushBatches()
+{
+  for (auto& [frame_id, batch] : batches_)
+  {
+    if (!batch.timestamps.empty())
+    {
+      decodeBatch(frame_id, batch);
+    }
+  }
+  batches_.clear();
+}
+
+void CanFrameProcessor::decodeBatch(const uint32_t frame_id, FrameBatch& batch)
+{
+  const size_t count = batch.timestamps.size();
+  const MessageEntry* entry = messages_.find(frame_id);
+  if (!entry)
+  {
+    countUnknownFrame(frame_id, count);
+  }
+  else
+  {
+    counters_.frames_matched += count;
+    const auto decode_start = std::chrono::steady_clock::now();
+    const dbcppp::IMessage* msg = entry->msg;
+    const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+    batch_values_.resize(count);
+    for (size_t index = 0; index < entry->decoded_signals.size(); index++)
+    {
+      const dbcppp::ISignal& sig = *entry->decoded_signals[index];
+      SeriesState* series = internedSeries((uint64_t(frame_id) << 16) | index, sig,
+                                           [&] { return rawSeriesName(*msg, sig); });
+      if (!series)
+      {
+        continue;  // not selected, skip decoding
+      }
+      BatchSignalLayout layout;
+      if (sig.MultiplexerIndicator() != dbcppp::ISignal::EMultiplexer::MuxValue && makeBatchLayout(sig, layout))
+      {
+        extractSignal(layout, batch.payloads.data(), count, batch_values_.data());
+        for (size_t i = 0; i < count; i++)
+        {
+          pushSample(*series, batch.timestamps[i], batch_values_[i]);
+        }
+        counters_.signals_decoded += count;
+        continue;
+      }
+      // Scalar fallback, frame by frame through dbcppp
+      for (size_t i = 0; i < count; i++)
+      {
+        uint8_t bytes[8];
+        for (int b = 0; b < 8; b++)
+        {
+          bytes[b] = uint8_t(batch.payloads[i] >> (8 * b));
+        }
+        if (sig.MultiplexerIndicator() != dbcppp::ISignal::EMultiplexer::MuxValue ||
+            (mux_sig && (mux_sig->Decode(bytes) == sig.MultiplexerSwitchValue())))
+        {
+          pushSample(*series, batch.timestamps[i], sig.RawToPhys(sig.Decode(bytes)));
+          counters_.signals_decoded++;
+        }
+      }
+    }
+    recordDecodeTime(msg, decode_start, count);
+  }
+  batch.payloads.clear();
+  batch.timestamps.clear();
+}
+
+bool CanFrameProcessor::passesIdFilter(const uint64_t frame_id) const
+{
+  // apply id filter only when filter list is not empty
+  return id_filter_.empty() || id_filter_.count(frame_id);
+}
+
 bool CanFrameProcessor::ProcessCanFrameRaw(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                                            const double timestamp_secs)
 {
-  auto msg_it = messages_.find(frame_id);
-  if (msg_it != messages_.end())
+  if (!isotp_sessions_.empty())
+  {
+    auto session_it = isotp_sessions_.find(frame_id);
+    if (session_it != isotp_sessions_.end())
+    {
+      return ProcessIsoTpFrame(frame_id, session_it->second, data_ptr, data_len, timestamp_secs);
+    }
+  }
+  const MessageEntry* entry = messages_.find(frame_id);
+  if (entry)
   {
-    const dbcppp::IMessage* msg = msg_it->second;
-    for (const dbcppp::ISignal& sig : msg->Signals())
+    counters_.frames_matched++;
+    const auto decode_start = std::chrono::steady_clock::now();
+    const dbcppp::IMessage* msg = entry->msg;
+    const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+    for (size_t index = 0; index < entry->decoded_signals.size(); index++)
     {
-      const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+      const dbcppp::ISignal& sig = *entry->decoded_signals[index];
       if (sig.MultiplexerIndicator() != dbcppp::ISignal::EMultiplexer::MuxValue ||
           (mux_sig && (mux_sig->Decode(data_ptr) == sig.MultiplexerSwitchValue())))
       {
-        double decoded_val = sig.RawToPhys(sig.Decode(data_ptr));
-        auto str = QString("can_frames/%1/%2")
-                       .arg(QString::fromStdString(msg->Name()), QString::fromStdString(sig.Name()))
-                       .toStdString();
-        // qCritical() << str.c_str();
-        auto it = data_map_.numeric.find(str);
-        if (it != data_map_.numeric.end())
-        {
-          auto& plot = it->second;
-          plot.pushBack({ timestamp_secs, decoded_val });
-        }
-        else
+        SeriesState* series = internedSeries((uint64_t(frame_id) << 16) | index, sig,
+                                             [&] { return rawSeriesName(*msg, sig); });
+        if (!series)
         {
-          auto& plot = data_map_.addNumeric(str)->second;
-          plot.pushBack({ timestamp_secs, decoded_val });
+          continue;  // not selected, skip decoding
         }
+        double decoded_val = sig.RawToPhys(sig.Decode(data_ptr));
+        pushSample(*series, timestamp_secs, decoded_val);
+        counters_.signals_decoded++;
       }
     }
+    recordDecodeTime(msg, decode_start);
     return true;
   }
   else
   {
+    countUnknownFrame(frame_id);
     return false;
   }
 }
+void CanFrameProcessor::setIsoTpChannels(const std::vector<IsoTpChannel>& channels, double timeout_secs)
+{
+  isotp_sessions_.clear();
+  isotp_timeout_ = timeout_secs;
+  if (protocol_ != CanProtocol::RAW)
+  {
+    return;
+  }
+  for (const IsoTpChannel& channel : channels)
+  {
+    for (const auto& [id, paired_id] : { std::make_pair(channel.request_id, channel.response_id),
+                                         std::make_pair(channel.response_id, channel.request_id) })
+    {
+      IsoTpSession& session = isotp_sessions_[id];
+      session.paired_id = paired_id;
+      session.buffer.assign(ISOTP_CLASSIC_MAX_PDU + ISOTP_DECODE_PADDING, 0);
+    }
+  }
+}
+
+std::vector<CanFrameProcessor::IsoTpChannel> CanFrameProcessor::parseIsoTpChannels(const QString& text)
+{
+  std::vector<IsoTpChannel> channels;
+  static const QRegularExpression pair_re("(\\w+)\\s*:\\s*(\\w+)");
+  auto it = pair_re.globalMatch(text);
+  while (it.hasNext())
+  {
+    const QRegularExpressionMatch match = it.next();
+    bool request_ok = false;
+    bool response_ok = false;
+    const uint32_t request_id = match.captured(1).toUInt(&request_ok, 16);
+    const uint32_t response_id = match.captured(2).toUInt(&response_ok, 16);
+    if (request_ok && response_ok)
+    {
+      channels.push_back({ request_id, response_id });
+    }
+  }
+  return channels;
+}
+
+bool CanFrameProcessor::ProcessIsoTpFrame(const uint32_t frame_id, IsoTpSession& session, const uint8_t* data_ptr,
+                                          const size_t data_len, const double timestamp_secs)
+{
+  if (data_len == 0)
+  {
+    return false;
+  }
+  counters_.frames_matched++;
+  // The high nibble of the first byte is the protocol control information
+  switch (data_ptr[0] >> 4)
+  {
+    case 0:  // single frame
+    {
+      size_t length = data_ptr[0] & 0x0F;
+      size_t offset = 1;
+      if (length == 0 && data_len > 8)
+      {
+        // CAN FD single frames longer than 7 bytes have their length in the second byte
+        length = data_ptr[1];
+        offset = 2;
+      }
+      if (length == 0 || offset + length > data_len)
+      {
+        return false;
+      }
+      // A new transfer replaces one that was not completed
+      abortIsoTpTransfer(session);
+      memcpy(session.buffer.data(), data_ptr + offset, length);
+      decodeIsoTpPdu(frame_id, session, length, timestamp_secs);
+      return true;
+    }
+    case 1:  // first frame
+    {
+      if (data_len < 2)
+      {
+        return false;
+      }
+      size_t length = size_t(data_ptr[0] & 0x0F) << 8 | data_ptr[1];
+      size_t offset = 2;
+      if (length == 0)
+      {
+        // Escape for PDUs longer than 4095 bytes, the length follows on 32 bits
+        if (data_len < 6)
+        {
+          return false;
+        }
+        length = size_t(data_ptr[2]) << 24 | size_t(data_ptr[3]) << 16 | size_t(data_ptr[4]) << 8 | data_ptr[5];
+        offset = 6;
+      }
+      abortIsoTpTransfer(session);
+      if (length > ISOTP_MAX_PDU || data_len <= offset)
+      {
+        counters_.isotp_pdus_aborted++;
+        return false;
+      }
+      if (session.buffer.size() < length + ISOTP_DECODE_PADDING)
+      {
+        session.buffer.resize(length + ISOTP_DECODE_PADDING);
+      }
+      session.length = length;
+      session.received = std::min(data_len - offset, length);
+      memcpy(session.buffer.data(), data_ptr + offset, session.received);
+      session.next_sequence = 1;
+      session.last_frame_ts = timestamp_secs;
+      return true;
+    }
+    case 2:  // consecutive frame
+    {
+      if (session.length == 0)
+      {
+        return false;  // the first frame was missed
+      }
+      if ((data_ptr[0] & 0x0F) != session.next_sequence || timestamp_secs - session.last_frame_ts > isotp_timeout_)
+      {
+        abortIsoTpTransfer(session);
+        return false;
+      }
+      const size_t count = std::min(data_len - 1, session.length - session.received);
+      memcpy(session.buffer.data() + session.received, data_ptr + 1, count);
+      session.received += count;
+      session.next_sequence = (session.next_sequence + 1) & 0x0F;
+      session.last_frame_ts = timestamp_secs;
+      if (session.received == session.length)
+      {
+        const size_t length = session.length;
+        session.length = 0;
+        decodeIsoTpPdu(frame_id, session, length, timestamp_secs);
+      }
+      return true;
+    }
+    case 3:  // flow control, for the transfer on the paired id
+    {
+      const uint8_t OVERFLOW_STATUS = 2;
+      if ((data_ptr[0] & 0x0F) == OVERFLOW_STATUS)
+      {
+        auto paired_it = isotp_sessions_.find(session.paired_id);
+        if (paired_it != isotp_sessions_.end())
+        {
+          abortIsoTpTransfer(paired_it->second);
+        }
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+void CanFrameProcessor::abortIsoTpTransfer(IsoTpSession& session)
+{
+  if (session.length > 0)
+  {
+    counters_.isotp_pdus_aborted++;
+    session.length = 0;
+  }
+}
+
+void CanFrameProcessor::decodeIsoTpPdu(const uint32_t frame_id, IsoTpSession& session, const size_t length,
+                                       const double timestamp_secs)
+{
+  counters_.isotp_pdus_completed++;
+  const uint8_t* pdu = session.buffer.data();
+  if (const MessageEntry* entry = messages_.find(frame_id))
+  {
+    const auto decode_start = std::chrono::steady_clock::now();
+    const dbcppp::IMessage* msg = entry->msg;
+    const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+    if (mux_sig && signalEndByte(*mux_sig) > length)
+    {
+      mux_sig = nullptr;
+    }
+    for (size_t index = 0; index < entry->decoded_signals.size(); index++)
+    {
+      const dbcppp::ISignal& sig = *entry->decoded_signals[index];
+      // Responses of different services share an id, only the signals within this PDU are decoded
+      if (signalEndByte(sig) > length)
+      {
+        continue;
+      }
+      if (sig.MultiplexerIndicator() != dbcppp::ISignal::EMultiplexer::MuxValue ||
+          (mux_sig && (mux_sig->Decode(pdu) == sig.MultiplexerSwitchValue())))
+      {
+        SeriesState* series = internedSeries((uint64_t(frame_id) << 16) | index, sig,
+                                             [&] { return rawSeriesName(*msg, sig); });
+        if (!series)
+        {
+          continue;  // not selected, skip decoding
+        }
+        pushSample(*series, timestamp_secs, sig.RawToPhys(sig.Decode(pdu)));
+        counters_.signals_decoded++;
+      }
+    }
+    recordDecodeTime(msg, decode_start);
+    return;
+  }
+
+  if (session.raw_series.empty())
+  {
+    const std::string prefix = "isotp/0x" + QString::number(frame_id, 16).toUpper().toStdString() + "/";
+    session.raw_series.push_back(getSeries(prefix + "length", nullptr));
+    for (size_t i = 0; i < ISOTP_RAW_BYTES; i++)
+    {
+      session.raw_series.push_back(getSeries(prefix + "byte" + std::to_string(i), nullptr));
+    }
+  }
+  if (session.raw_series[0])
+  {
+    pushSample(*session.raw_series[0], timestamp_secs, double(length));
+  }
+  for (size_t i = 0; i < std::min(length, ISOTP_RAW_BYTES); i++)
+  {
+    if (session.raw_series[i + 1])
+    {
+      pushSample(*session.raw_series[i + 1], timestamp_secs, pdu[i]);
+    }
+  }
+}
+
 bool CanFrameProcessor::ProcessCanFrameN2k(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                                            const double timestamp_secs)
 {
-  N2kMsgStandard n2k_msg(frame_id, data_ptr, data_len, timestamp_secs);
+  const N2kFrameView frame(frame_id, data_ptr, data_len, timestamp_secs);
 
-  if (fast_packet_pgns_set_.count(n2k_msg.GetPgn()))
+  const MessageEntry* entry = messages_.find(frame.GetPgn());
+  if (entry && entry->fast_packet)
   {
+    counters_.frames_matched++;
     fp_generic_fast_packet_t fp_unpacked;
-    fp_generic_fast_packet_unpack(&fp_unpacked, n2k_msg.GetDataPtr(), FP_GENERIC_FAST_PACKET_LENGTH);
+    fp_generic_fast_packet_unpack(&fp_unpacked, frame.GetDataPtr(), FP_GENERIC_FAST_PACKET_LENGTH);
 
     // Find the current fast packet, return null one if it does not exists.
-    auto current_fp_it = fast_packets_map_.find(n2k_msg.GetFrameId());
+    auto current_fp_it = fast_packets_map_.find(frame.GetFrameId());
     auto& current_fp = current_fp_it != fast_packets_map_.end() ? current_fp_it->second : null_n2k_fast_ptr_;
 
     if (fp_unpacked.chunk_id == FP_GENERIC_FAST_PACKET_CHUNK_ID_FIRST_CHUNK_CHOICE)
     {
+      if (current_fp && !current_fp->IsComplete())
+      {
+        counters_.fast_packets_aborted++;
+      }
+      counters_.fast_packets_started++;
       // First chunk's data is only 6 bytes
-      fast_packets_map_[n2k_msg.GetFrameId()] = std::make_unique<N2kMsgFast>(
-          n2k_msg.GetFrameId(), n2k_msg.GetDataPtr() + 2, 6ul, timestamp_secs, fp_unpacked.len_bytes);
+      fast_packets_map_[frame.GetFrameId()] = std::make_unique<N2kMsgFast>(
+          frame.GetFrameId(), frame.GetDataPtr() + 2, 6ul, timestamp_secs, fp_unpacked.len_bytes);
     }
     else
     {
       if (current_fp)
       {
-        current_fp->AppendData(n2k_msg.GetDataPtr() + 1, 7ul);
+        current_fp->AppendData(frame.GetDataPtr() + 1, 7ul);
       }
     }
     if (current_fp && current_fp->IsComplete())
     {
-      ForwardN2kSignalsToPlot(*current_fp);
-      current_fp.release();
+      counters_.fast_packets_completed++;
+      ForwardN2kSignalsToPlot(*current_fp, entry);
+      current_fp.reset();
       return true;
     }
   }
   else
   {
-    ForwardN2kSignalsToPlot(n2k_msg);
-    return true;
+    if (ForwardN2kFrameToPlot(frame, entry))
+    {
+      counters_.frames_matched++;
+      return true;
+    }
+    countUnknownFrame(frame_id);
   }
   return false;
 }
 bool CanFrameProcessor::ProcessCanFrameJ1939(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                                              const double timestamp_secs)
 {
-  N2kMsgStandard n2k_msg(frame_id, data_ptr, data_len, timestamp_secs);
-  ForwardN2kSignalsToPlot(n2k_msg);
-  return true;
+  const N2kFrameView frame(frame_id, data_ptr, data_len, timestamp_secs);
+  if (ForwardN2kFrameToPlot(frame, messages_.find(frame.GetPgn())))
+  {
+    counters_.frames_matched++;
+    return true;
+  }
+  countUnknownFrame(frame_id);
+  return false;
 }
 
-void CanFrameProcessor::ForwardN2kSignalsToPlot(const N2kMsgInterface& n2k_msg)
+bool CanFrameProcessor::ForwardN2kFrameToPlot(const N2kFrameView& frame, const MessageEntry* entry)
+{
+  // Signals past the DLC read 0xFF, "not available", as if the sender had padded the frame
+  if (entry && entry->end_byte > frame.GetDataLen())
+  {
+    uint8_t padded_data[N2kFrameView::PADDED_SIZE];
+    return ForwardN2kSignalsToPlot(frame.Padded(padded_data), entry);
+  }
+  return ForwardN2kSignalsToPlot(frame, entry);
+}
+
+template <typename N2kMsg>
+bool CanFrameProcessor::ForwardN2kSignalsToPlot(const N2kMsg& n2k_msg, const MessageEntry* entry)
 {
-  auto protocol_prefix = protocol_ == CanProtocol::NMEA2K ? QString("nmea2k_msg") : QString("j1939_msg");
   // qCritical() << "frame_id:" << QString::number(dbc_id) << "\tcan_id:" << QString::number(n2k_msg.GetFrameId());
-  auto messages_iter = messages_.find(n2k_msg.GetPgn());
-  if (messages_iter != messages_.end())
+  if (entry)
   {
-    const dbcppp::IMessage* msg = messages_iter->second;
+    const auto decode_start = std::chrono::steady_clock::now();
+    const dbcppp::IMessage* msg = entry->msg;
     // qCritical() << "msg_name:" << QString::fromStdString(msg->Name());
-    for (const dbcppp::ISignal& sig : msg->Signals())
+    const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+    for (size_t index = 0; index < entry->decoded_signals.size(); index++)
     {
-      const dbcppp::ISignal* mux_sig = msg->MuxSignal();
+      const dbcppp::ISignal& sig = *entry->decoded_signals[index];
       if (sig.MultiplexerIndicator() != dbcppp::ISignal::EMultiplexer::MuxValue ||
           (mux_sig && (mux_sig->Decode(n2k_msg.GetDataPtr()) == sig.MultiplexerSwitchValue())))
       {
-        double decoded_val = sig.RawToPhys(sig.Decode(n2k_msg.GetDataPtr()));
-        std::string ts_name;
-        if (n2k_msg.GetPduFormat() < 240)
-        {
-          auto destination_qstr = QString("%1").arg(n2k_msg.GetPduSpecific(), 2, 16, QLatin1Char('0')).toUpper();
-          ts_name = QString("%1/PDUF1/%2 (0x%3)/0x%4/0x%5/%6")
-                        .arg(protocol_prefix,
-                             QString::fromStdString(msg->Name()),
-                             QString("%1").arg(n2k_msg.GetPgn(), 4, 16, QLatin1Char('0')).toUpper(),
-                             QString("%1").arg(n2k_msg.GetSourceAddr(), 2, 16, QLatin1Char('0')).toUpper(),
-                             destination_qstr, QString::fromStdString(sig.Name()))
-                        .toStdString();
-        }
-        else
-        {
-          ts_name = QString("%1/PDUF2/%2 (0x%3)/0x%4/%5")
-                        .arg(protocol_prefix,
-                             QString::fromStdString(msg->Name()),
-                             QString("%1").arg(n2k_msg.GetPgn(), 5, 16, QLatin1Char('0')).toUpper(),
-                             QString("%1").arg(n2k_msg.GetSourceAddr(), 2, 16, QLatin1Char('0')).toUpper(),
-                             QString::fromStdString(sig.Name()))
-                        .toStdString();
-        }
-        // qCritical() << str.c_str();
-        auto it = data_map_.numeric.find(ts_name);
-        if (it != data_map_.numeric.end())
-        {
-          auto& plot = it->second;
-          plot.pushBack({ n2k_msg.GetTimeStamp(), decoded_val });
-        }
-        else
+        SeriesState* series = internedSeries(n2kSeriesKey(n2k_msg.GetFrameId(), index), sig,
+                                             [&] { return n2kSeriesName(*msg, sig, n2k_msg.GetFrameId()); });
+        if (!series)
         {
-          auto& plot = data_map_.addNumeric(ts_name)->second;
-          plot.pushBack({ n2k_msg.GetTimeStamp(), decoded_val });
+          continue;  // not selected, skip decoding
         }
+        double decoded_val = sig.RawToPhys(sig.Decode(n2k_msg.GetDataPtr()));
+        pushSample(*series, n2k_msg.GetTimeStamp(), decoded_val);
+        counters_.signals_decoded++;
+      }
+    }
+    recordDecodeTime(msg, decode_start);
+    return true;
+  }
+  return false;
+}
+
+void CanFrameProcessor::setIdFilter(const std::unordered_set<uint64_t>& id_filter)
+{
+  id_filter_ = id_filter;
+}
+
+void CanFrameProcessor::setStatisticsInterval(double interval_secs)
+{
+  statistics_interval_ = interval_secs;
+}
+
+void CanFrameProcessor::setStatisticsPrefix(const std::string& prefix)
+{
+  statistics_prefix_ = prefix;
+}
+
+CanFrameProcessor::Statistics CanFrameProcessor::statistics(size_t top_unknown_ids) const
+{
+  Statistics snapshot;
+  snapshot.counters = counters_;
+  snapshot.top_unknown_ids = topUnknownIds(top_unknown_ids);
+  for (const auto& [msg, timing] : message_timings_)
+  {
+    snapshot.messages.push_back({ msg->Name(), timing.frames, timing.decode_ns });
+  }
+  return snapshot;
+}
+
+std::vector<std::pair<uint32_t, uint64_t>> CanFrameProcessor::topUnknownIds(size_t count) const
+{
+  std::vector<std::pair<uint32_t, uint64_t>> top(unknown_id_counts_.begin(), unknown_id_counts_.end());
+  count = std::min(count, top.size());
+  std::partial_sort(top.begin(), top.begin() + count, top.end(),
+                    [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+  top.resize(count);
+  return top;
+}
+
+void CanFrameProcessor::countUnknownFrame(const uint32_t frame_id, uint64_t frames)
+{
+  counters_.frames_unknown += frames;
+  unknown_id_counts_[frame_id] += frames;
+}
+
+void CanFrameProcessor::recordDecodeTime(const dbcppp::IMessage* msg,
+                                         const std::chrono::steady_clock::time_point& decode_start,
+                                         uint64_t frames)
+{
+  const uint64_t decode_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - decode_start).count();
+  auto& timing = message_timings_[msg];
+  timing.frames += frames;
+  timing.decode_ns += decode_ns;
+  timing.interval_frames += frames;
+  timing.interval_decode_ns += decode_ns;
+}
+
+void CanFrameProcessor::publishStatistics(double timestamp_secs)
+{
+  last_statistics_ts_ = timestamp_secs;
+  auto publish = [this, timestamp_secs](const std::string& name, double value) {
+    PJ::PlotData* plot = getPlot(statistics_prefix_ + name);
+    if (deferred_storage_)
+    {
+      deferred_statistics_.push_back({ plot, { timestamp_secs, value } });
+    }
+    else
+    {
+      plot->pushBack({ timestamp_secs, value });
+    }
+  };
+  publish("frames_in", counters_.frames_in);
+  publish("frames_matched", counters_.frames_matched);
+  publish("frames_filtered", counters_.frames_filtered);
+  publish("frames_unknown", counters_.frames_unknown);
+  publish("signals_decoded", counters_.signals_decoded);
+  if (protocol_ == CanProtocol::NMEA2K)
+  {
+    publish("fast_packets/started", counters_.fast_packets_started);
+    publish("fast_packets/completed", counters_.fast_packets_completed);
+    publish("fast_packets/aborted", counters_.fast_packets_aborted);
+  }
+  if (!isotp_sessions_.empty())
+  {
+    publish("isotp/completed", counters_.isotp_pdus_completed);
+    publish("isotp/aborted", counters_.isotp_pdus_aborted);
+  }
+  // Mean decode time per frame since the last publication, to spot the expensive messages
+  for (auto& [msg, timing] : message_timings_)
+  {
+    if (timing.interval_frames > 0)
+    {
+      publish("decode_ns/" + msg->Name(), double(timing.interval_decode_ns) / timing.interval_frames);
+      timing.interval_frames = 0;
+      timing.interval_decode_ns = 0;
+    }
+  }
+  for (const auto& [frame_id, count] : topUnknownIds(TOP_UNKNOWN_IDS))
+  {
+    publish("unknown_ids/0x" + QString::number(frame_id, 16).toUpper().toStdString(), count);
+  }
+}
+
+std::string CanFrameProcessor::rawSeriesName(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig) const
+{
+  return QString("can_frames/%1/%2")
+      .arg(QString::fromStdString(msg.Name()), QString::fromStdString(sig.Name()))
+      .toStdString();
+}
+
+std::string CanFrameProcessor::n2kSeriesName(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig,
+                                             const uint32_t frame_id) const
+{
+  auto protocol_prefix = protocol_ == CanProtocol::NMEA2K ? QString("nmea2k_msg") : QString("j1939_msg");
+  const uint32_t pgn = PGN_FROM_FRAME_ID(frame_id);
+  const uint32_t pdu_format = (frame_id >> 16) & 0xFF;
+  const uint32_t pdu_specific = (frame_id >> 8) & 0xFF;
+  const uint32_t source_addr = frame_id & 0xFF;
+  if (pdu_format < 240)
+  {
+    auto destination_qstr = QString("%1").arg(pdu_specific, 2, 16, QLatin1Char('0')).toUpper();
+    return QString("%1/PDUF1/%2 (0x%3)/0x%4/0x%5/%6")
+        .arg(protocol_prefix,
+             QString::fromStdString(msg.Name()),
+             QString("%1").arg(pgn, 4, 16, QLatin1Char('0')).toUpper(),
+             QString("%1").arg(source_addr, 2, 16, QLatin1Char('0')).toUpper(),
+             destination_qstr, QString::fromStdString(sig.Name()))
+        .toStdString();
+  }
+  else
+  {
+    return QString("%1/PDUF2/%2 (0x%3)/0x%4/%5")
+        .arg(protocol_prefix,
+             QString::fromStdString(msg.Name()),
+             QString("%1").arg(pgn, 5, 16, QLatin1Char('0')).toUpper(),
+             QString("%1").arg(source_addr, 2, 16, QLatin1Char('0')).toUpper(),
+             QString::fromStdString(sig.Name()))
+        .toStdString();
+  }
+}
+
+std::vector<std::string> CanFrameProcessor::seriesNames(const uint32_t frame_id) const
+{
+  std::vector<std::string> names;
+  if (protocol_ == CanProtocol::RAW)
+  {
+    if (const MessageEntry* entry = messages_.find(frame_id))
+    {
+      for (const dbcppp::ISignal* sig : entry->decoded_signals)
+      {
+        names.push_back(rawSeriesName(*entry->msg, *sig));
+      }
+    }
+  }
+  else
+  {
+    if (const MessageEntry* entry = messages_.find(PGN_FROM_FRAME_ID(frame_id)))
+    {
+      for (const dbcppp::ISignal* sig : entry->decoded_signals)
+      {
+        names.push_back(n2kSeriesName(*entry->msg, *sig, frame_id));
+      }
+    }
+  }
+  return names;
+}
+
+void CanFrameProcessor::setSeriesSelection(const std::unordered_set<std::string>& selection)
+{
+  series_selection_ = selection;
+}
+
+void CanFrameProcessor::setChangeOnlyMode(bool enabled, double deadband, double max_hold_secs)
+{
+  change_only_ = enabled;
+  change_only_deadband_ = deadband;
+  change_only_max_hold_ = max_hold_secs;
+}
+
+void CanFrameProcessor::flushPendingSamples()
+{
+  for (auto& [name, series] : series_)
+  {
+    if (series.has_pending)
+    {
+      storeSample(series, series.pending);
+      series.last_stored_ts = series.pending.x;
+      series.has_pending = false;
+    }
+  }
+}
+
+CanFrameProcessor::SeriesState* CanFrameProcessor::getSeries(const std::string& name, const dbcppp::ISignal* sig)
+{
+  auto it = series_.find(name);
+  if (it == series_.end())
+  {
+    SeriesState series;
+    if (!series_selection_.empty() && !series_selection_.count(name))
+    {
+      // Cached without plot, so that the selection is looked up only once per series
+      it = series_.emplace(name, std::move(series)).first;
+      return nullptr;
+    }
+    series.plot = getPlot(name);
+    series.deadband = sig ? signalDeadband(*sig) : change_only_deadband_;
+    if (retention_.decimation_factor > 0)
+    {
+      series.decimated = getPlot("decimated/" + name);
+    }
+    size_t tier_factor = 1;
+    for (size_t level = 0; level < tier_levels_; level++)
+    {
+      tier_factor *= tier_factor_;
+      series.tiers.push_back({ getPlot("lod_x" + std::to_string(tier_factor) + "/" + name), tier_factor, MinMaxBucket() });
+    }
+    it = series_.emplace(name, std::move(series)).first;
+  }
+  return it->second.plot ? &it->second : nullptr;
+}
+
+void CanFrameProcessor::pushSample(SeriesState& series, double timestamp, double value)
+{
+  if (change_only_ && series.has_value)
+  {
+    // Written as a negated comparison so that NaN counts as a change
+    const bool changed = !(std::abs(value - series.last_value) <= series.deadband);
+    const bool hold_expired = change_only_max_hold_ > 0.0 &&
+                              timestamp - series.last_stored_ts >= change_only_max_hold_;
+    if (!changed && !hold_expired)
+    {
+      series.pending = { timestamp, value };
+      series.has_pending = true;
+      return;
+    }
+    if (changed && series.has_pending)
+    {
+      // Close the previous step so that the curve looks the same as with every sample stored
+      storeSample(series, series.pending);
+    }
+  }
+  series.has_pending = false;
+  storeSample(series, { timestamp, value });
+  series.has_value = true;
+  series.last_value = value;
+  series.last_stored_ts = timestamp;
+}
+
+void CanFrameProcessor::storeSample(SeriesState& series, const PJ::PlotData::Point& point)
+{
+  if (deferred_storage_)
+  {
+    if (series.deferred.empty())
+    {
+      deferred_series_.push_back(&series);
+    }
+    series.deferred.push_back(point);
+  }
+  else
+  {
+    writeSample(series, point);
+  }
+}
+
+void CanFrameProcessor::writeSample(SeriesState& series, const PJ::PlotData::Point& point)
+{
+  series.plot->pushBack(point);
+  if (!series.tiers.empty())
+  {
+    feedTiers(series, point);
+  }
+  if (retention_.window_secs > 0.0 || retention_.max_samples > 0)
+  {
+    trimToRetention(*series.plot, retention_.window_secs, retention_.max_samples,
+                    series.decimated ? &series : nullptr);
+  }
+}
+
+void CanFrameProcessor::setDeferredStorage(bool enabled)
+{
+  deferred_storage_ = enabled;
+}
+
+void CanFrameProcessor::mergeDeferredSamples()
+{
+  for (SeriesState* series : deferred_series_)
+  {
+    for (const PJ::PlotData::Point& point : series->deferred)
+    {
+      writeSample(*series, point);
+    }
+    // The capacity is kept for the next cycle
+    series->deferred.clear();
+  }
+  deferred_series_.clear();
+  for (const auto& [plot, point] : deferred_statistics_)
+  {
+    plot->pushBack(point);
+  }
+  deferred_statistics_.clear();
+}
+
+void CanFrameProcessor::setRetentionPolicy(const RetentionPolicy& policy)
+{
+  retention_ = policy;
+}
+
+void CanFrameProcessor::trimToRetention(PJ::PlotData& plot, double window_secs, size_t max_samples,
+                                        SeriesState* decimate_into)
+{
+  // A single sample was added, so this pops one sample in the common case
+  while (plot.size() > 0 && ((max_samples > 0 && plot.size() > max_samples) ||
+                             (window_secs > 0.0 && plot.back().x - plot.front().x > window_secs)))
+  {
+    if (decimate_into)
+    {
+      decimateSample(*decimate_into, plot.front());
+    }
+    plot.popFront();
+  }
+}
+
+void CanFrameProcessor::decimateSample(SeriesState& series, const PJ::PlotData::Point& point)
+{
+  if (!series.decimated_bucket.add(point, retention_.decimation_factor))
+  {
+    return;
+  }
+  // Keep both extremes of the bucket, so that peaks survive decimation
+  PJ::PlotData::Point extremes[2];
+  const size_t count = series.decimated_bucket.take(extremes);
+  for (size_t i = 0; i < count; i++)
+  {
+    series.decimated->pushBack(extremes[i]);
+  }
+  // Two samples per bucket, the same number of samples covers a longer span
+  trimToRetention(*series.decimated, retention_.window_secs * retention_.decimation_factor / 2,
+                  retention_.max_samples, nullptr);
+}
+
+void CanFrameProcessor::setDecimationTiers(size_t factor, size_t levels)
+{
+  // A factor below 2 would not reduce anything
+  tier_factor_ = factor;
+  tier_levels_ = factor >= 2 ? levels : 0;
+}
+
+void CanFrameProcessor::feedTiers(SeriesState& series, const PJ::PlotData::Point& point)
+{
+  // Tier 0 closes a bucket every factor samples, every tier above every factor buckets of the tier
+  // below, so tier k covers factor^k samples per bucket and does work only once per factor^(k-1)
+  // samples. The extremes of a bucket are passed up as one unit.
+  PJ::PlotData::Point extremes[2] = { point, point };
+  size_t extremes_count = 1;
+  for (auto& tier : series.tiers)
+  {
+    if (!tier.bucket.addExtremes(extremes, extremes_count, tier_factor_))
+    {
+      break;
+    }
+    extremes_count = tier.bucket.take(extremes);
+    for (size_t i = 0; i < extremes_count; i++)
+    {
+      tier.plot->pushBack(extremes[i]);
+    }
+    if (retention_.window_secs > 0.0 || retention_.max_samples > 0)
+    {
+      // At most two samples per factor^k samples, the same number of samples covers a longer span
+      trimToRetention(*tier.plot, retention_.window_secs * tier.factor / 2, retention_.max_samples, nullptr);
+    }
+  }
+}
+
+void CanFrameProcessor::setSeriesMutex(std::mutex* series_mutex)
+{
+  series_mutex_ = series_mutex;
+}
+
+PJ::PlotData* CanFrameProcessor::getPlot(const std::string& name)
+{
+  std::unique_lock<std::mutex> lock;
+  if (series_mutex_)
+  {
+    lock = std::unique_lock<std::mutex>(*series_mutex_);
+  }
+  auto plot_it = data_map_.numeric.find(name);
+  if (plot_it == data_map_.numeric.end())
+  {
+    plot_it = data_map_.addNumeric(name);
+  }
+  return &plot_it->second;
+}
+
+double CanFrameProcessor::signalDeadband(const dbcppp::ISignal& sig) const
+{
+  for (const dbcppp::IAttribute& attr : sig.AttributeValues())
+  {
+    if (attr.Name() == "PJ_Deadband")
+    {
+      if (const double* value = std::get_if<double>(&attr.Value()))
+      {
+        return *value;
+      }
+      if (const int64_t* value = std::get_if<int64_t>(&attr.Value()))
+      {
+        return static_cast<double>(*value);
       }
     }
   }
+  return change_only_deadband_;
 }
 
-uint64_t CanFrameProcessor::getId (const uint64_t frame_id)
+uint64_t CanFrameProcessor::getId (const uint64_t frame_id) const
 {
   return (EXTENDED_IDENTIFIER & frame_id)? (~EXTENDED_IDENTIFIER) & frame_id : frame_id;
 }
\ No newline at end of file
@@ -4,12 +4,19 @@
 #include <QRegularExpression>
 #include <QDebug>
 #include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <fstream>
 
 #include <dbcppp/Network.h>
 #include <PlotJuggler/plotdata.h>
 
-#include "N2kMsg/N2kMsgStandard.h"
+#include "IdLookupTable.h"
+#include "MinMaxBucket.h"
+#include "NameMatcher.h"
+#include "N2kMsg/N2kFrameView.h"
 #include "N2kMsg/N2kMsgFast.h"
 
 class CanFrameProcessor
@@ -24,10 +31,131 @@ public:
   CanFrameProcessor(std::ifstream& dbc_file, CanProtocol protocol, PJ::PlotDataMapRef& data_map,
                     const std::unordered_map<std::string, QRegularExpression>& filter_list = {});
 
+  // The payload is decoded in place, data_ptr must point to at least 8 readable bytes even when
+  // data_len is smaller
   bool ProcessCanFrame(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                        const double timestamp_secs);
   inline bool isExtendedId(){ return is_extended_id_; };
 
+  // Batch decoding for offline loads. Classic RAW frames are queued per id and decoded a signal at
+  // a time over the whole batch, in a shift/mask/scale loop the compiler vectorizes. Each series still
+  // receives its samples in time order, but series are filled batch by batch, and decoder statistics
+  // are not published. Other frames are decoded right away. Call flushBatches() after the last frame.
+  void queueCanFrame(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
+                     const double timestamp_secs);
+  void flushBatches();
+
+  // DBC hot reload. parseDatabase builds the decode tables of a DBC for this processor and may run on
+  // any thread while frames are decoded, it returns nullptr if the file could not be parsed. The
+  // decoding thread adopts the tables with adoptDatabase between batches of frames. Series are kept
+  // across reloads.
+  struct DecodeTables;
+  std::unique_ptr<DecodeTables> parseDatabase(std::ifstream& dbc_file) const;
+  void adoptDatabase(DecodeTables& tables);
+
+  // Frames whose id is not in the filter are dropped (and counted), no filtering when it is empty
+  void setIdFilter(const std::unordered_set<uint64_t>& id_filter);
+  bool passesIdFilter(const uint64_t frame_id) const;
+
+  // Decoder statistics. The counters belong to the thread calling ProcessCanFrame, read them from
+  // another thread only while holding the lock that serializes ProcessCanFrame.
+  struct Counters
+  {
+    uint64_t frames_in = 0;
+    uint64_t frames_matched = 0;
+    uint64_t frames_filtered = 0;
+    uint64_t frames_unknown = 0;
+    uint64_t signals_decoded = 0;
+    uint64_t fast_packets_started = 0;
+    uint64_t fast_packets_completed = 0;
+    uint64_t fast_packets_aborted = 0;
+    uint64_t isotp_pdus_completed = 0;
+    uint64_t isotp_pdus_aborted = 0;
+  };
+  struct MessageTiming
+  {
+    std::string name;
+    uint64_t frames;
+    uint64_t decode_ns;
+  };
+  struct Statistics
+  {
+    Counters counters;
+    std::vector<std::pair<uint32_t, uint64_t>> top_unknown_ids;  // frame id and count, most frequent first
+    std::vector<MessageTiming> messages;
+  };
+  Statistics statistics(size_t top_unknown_ids = 10) const;
+  // Publish the statistics as can_stats/... series every interval_secs of frame time, 0 disables
+  void setStatisticsInterval(double interval_secs);
+  // Path of the statistics series instead of can_stats/, for processors sharing a data map
+  void setStatisticsPrefix(const std::string& prefix);
+
+  // Change-only storage: a sample is stored only when the decoded value moves by more than the
+  // deadband (overridable per signal with the DBC attribute PJ_Deadband). The last unchanged sample
+  // before a change is kept as well, so the rendered curve is identical. A non-zero max_hold_secs
+  // stores an unchanged sample at least that often, which keeps constant signals visible in streams.
+  // Deadbands are resolved when a series is created, so call this before the first frame.
+  void setChangeOnlyMode(bool enabled, double deadband = 0.0, double max_hold_secs = 0.0);
+  // Store the held back sample of every series, call once the whole log has been decoded
+  void flushPendingSamples();
+  // Deferred storage, for streams decoded without holding the lock of the data map: samples and
+  // statistics are staged per series, and only written to the plot data by mergeDeferredSamples(),
+  // which the caller runs with the lock held. New series are still created during decoding, under the
+  // series mutex, which then has to be the lock of the data map. Call before the first frame.
+  void setDeferredStorage(bool enabled);
+  void mergeDeferredSamples();
+
+  // Retention for large logs: every series keeps at most max_samples samples and the last
+  // window_secs seconds (0 disables a limit). With a decimation factor, trimmed samples are folded
+  // into min/max pairs per decimation_factor samples and kept in "decimated/<series>" instead of
+  // being dropped. That series holds as many samples, over decimation_factor / 2 times the window.
+  // Only for file loads: PlotJuggler moves streamed samples out of the data map at every update, so
+  // the series of a stream never grow here; their buffer is set in PlotJuggler.
+  struct RetentionPolicy
+  {
+    double window_secs = 0.0;
+    size_t max_samples = 0;
+    size_t decimation_factor = 0;
+  };
+  void setRetentionPolicy(const RetentionPolicy& policy);
+
+  // Multi resolution tiers maintained at ingest: tier k holds the min/max of every factor^k samples
+  // in "lod_x<factor^k>/<series>", so that zoomed out views of high rate signals can plot a tier
+  // with a few points per pixel. Full rate data stays in the series itself. Tiers follow the retention
+  // policy over a proportionally longer window. Call before the first frame.
+  void setDecimationTiers(size_t factor, size_t levels);
+
+  // Signal selection on "Message/Signal" paths: a signal is decoded if it matches an include pattern
+  // (or there are none) and no exclude pattern. Signals are selected once per message, unselected
+  // signals are never extracted. Also applies to reloaded databases, call before the first frame.
+  void setSignalSelection(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
+
+  // ISO-TP (ISO 15765-2) reassembly in RAW mode, normal addressing. Frames of the ids of a channel are
+  // reassembled into PDUs instead of being decoded one by one, with the CAN FD escapes for longer
+  // single and first frames. A complete PDU is decoded with the DBC message of its id, signals being
+  // placed from the first PDU byte, or published as isotp/0x<id>/length and .../byte<N> for its first
+  // bytes when the database has no such message. A transfer is aborted when a consecutive frame is
+  // out of sequence or comes more than timeout_secs after the previous one, or when the receiver
+  // answers with an overflow flow control on the paired id. Call before the first frame.
+  struct IsoTpChannel
+  {
+    uint32_t request_id;
+    uint32_t response_id;
+  };
+  void setIsoTpChannels(const std::vector<IsoTpChannel>& channels, double timeout_secs = 1.0);
+  // Parses "request:response" pairs of hex ids separated by commas, e.g. "7E0:7E8, 7E1:7E9"
+  static std::vector<IsoTpChannel> parseIsoTpChannels(const QString& text);
+
+  // Processors decoding into the same data map from several threads create their series under this
+  // mutex, the series themselves must not be shared. Call before the first frame.
+  void setSeriesMutex(std::mutex* series_mutex);
+
+  // Names of all series a frame with this id decodes into, empty if the id is not in the database
+  std::vector<std::string> seriesNames(const uint32_t frame_id) const;
+  // Decode only the signals of the selected series, all of them when the selection is empty.
+  // Call before the first frame.
+  void setSeriesSelection(const std::unordered_set<std::string>& selection);
+
 private:
   bool ProcessCanFrameRaw(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                           const double timestamp_secs);
@@ -35,29 +163,169 @@ private:
                           const double timestamp_secs);
   bool ProcessCanFrameJ1939(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
                             const double timestamp_secs);
-  void ForwardN2kSignalsToPlot(const N2kMsgInterface& n2k_msg);
+  // A message passing the name filter and the signals of it that are decoded
+  struct MessageEntry
+  {
+    const dbcppp::IMessage* msg = nullptr;
+    std::vector<const dbcppp::ISignal*> decoded_signals;
+    bool fast_packet = false;  // NMEA2K message sent as fast packet
+    // Byte after the last one read by the decoded signals and the multiplexer, frames with a
+    // shorter DLC are padded
+    size_t end_byte = 0;
+  };
+  // Returns false if the PGN is not in the database, i.e. entry is null. N2kMsg is N2kFrameView for
+  // single frames, N2kMsgFast for reassembled fast packets.
+  template <typename N2kMsg>
+  bool ForwardN2kSignalsToPlot(const N2kMsg& n2k_msg, const MessageEntry* entry);
+  // Single frame of a PGN in the database, padded when its signals read past the DLC
+  bool ForwardN2kFrameToPlot(const N2kFrameView& frame, const MessageEntry* entry);
+
+  // Frames of one id waiting to be decoded together, payloads are stored as little endian words
+  struct FrameBatch
+  {
+    std::vector<uint64_t> payloads;
+    std::vector<double> timestamps;
+  };
+  void decodeBatch(const uint32_t frame_id, FrameBatch& batch);
+
+  struct SeriesState
+  {
+    PJ::PlotData* plot = nullptr;
+    double deadband = 0.0;
+    bool has_value = false;
+    double last_value = 0.0;     // last value stored in plot
+    double last_stored_ts = 0.0;
+    bool has_pending = false;    // unchanged sample held back in change-only mode
+    PJ::PlotData::Point pending;
+    // Samples waiting for mergeDeferredSamples() in deferred storage
+    std::vector<PJ::PlotData::Point> deferred;
+    // Min/max bucket of the samples trimmed by the retention policy
+    PJ::PlotData* decimated = nullptr;
+    MinMaxBucket decimated_bucket;
+    struct Tier
+    {
+      PJ::PlotData* plot;
+      size_t factor;  // factor^k of tier k
+      MinMaxBucket bucket;
+    };
+    std::vector<Tier> tiers;
+  };
+
+  // Reassembly of the ISO-TP transfers sent on one id
+  struct IsoTpSession
+  {
+    uint32_t paired_id;  // the flow control of this id's transfers is sent there
+    // Preallocated for the largest classic PDU, PDU bytes followed by padding for the signal decoders
+    std::vector<uint8_t> buffer;
+    size_t length = 0;  // announced length of the running transfer, 0 when there is none
+    size_t received = 0;
+    uint8_t next_sequence = 0;
+    double last_frame_ts = 0.0;
+    // Series of the PDUs without DBC message, length then bytes, created on first use
+    std::vector<SeriesState*> raw_series;
+  };
+  bool ProcessIsoTpFrame(const uint32_t frame_id, IsoTpSession& session, const uint8_t* data_ptr,
+                         const size_t data_len, const double timestamp_secs);
+  void abortIsoTpTransfer(IsoTpSession& session);
+  void decodeIsoTpPdu(const uint32_t frame_id, IsoTpSession& session, const size_t length, const double timestamp_secs);
+
+  // Returns nullptr for series that are not selected. Series without signal, e.g. raw ISO-TP bytes, use
+  // the default deadband.
+  SeriesState* getSeries(const std::string& name, const dbcppp::ISignal* sig);
+  // Series by an interned key (frame id or PGN/addresses, and signal index), the name is only
+  // formatted the first time a key is seen. Returns nullptr for series that are not selected.
+  template <typename NameFunc>
+  SeriesState* internedSeries(uint64_t key, const dbcppp::ISignal& sig, NameFunc make_name);
+  uint64_t n2kSeriesKey(const uint32_t frame_id, size_t signal_index) const;
+  void pushSample(SeriesState& series, double timestamp, double value);
+  void storeSample(SeriesState& series, const PJ::PlotData::Point& point);
+  // Appends to the plot data, with the retention policy and the tiers
+  void writeSample(SeriesState& series, const PJ::PlotData::Point& point);
+  void trimToRetention(PJ::PlotData& plot, double window_secs, size_t max_samples, SeriesState* decimate_into);
+  void decimateSample(SeriesState& series, const PJ::PlotData::Point& point);
+  void feedTiers(SeriesState& series, const PJ::PlotData::Point& point);
+  PJ::PlotData* getPlot(const std::string& name);
+  std::vector<std::pair<uint32_t, uint64_t>> topUnknownIds(size_t count) const;
+  void countUnknownFrame(const uint32_t frame_id, uint64_t frames = 1);
+  void recordDecodeTime(const dbcppp::IMessage* msg, const std::chrono::steady_clock::time_point& decode_start,
+                        uint64_t frames = 1);
+  void publishStatistics(double timestamp_secs);
+  double signalDeadband(const dbcppp::ISignal& sig) const;
+  std::string rawSeriesName(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig) const;
+  std::string n2kSeriesName(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig, const uint32_t frame_id) const;
+
+  std::unique_ptr<DecodeTables> buildTables(std::ifstream& dbc_file) const;
+  bool isSignalSelected(const dbcppp::IMessage& msg, const dbcppp::ISignal& sig) const;
 
   // get correct extended can fd id
-  uint64_t getId (const uint64_t frame_id);
+  uint64_t getId (const uint64_t frame_id) const;
   // Common
   CanProtocol protocol_;
 
   // Database
   std::unique_ptr<dbcppp::INetwork> can_network_ = nullptr;
-  std::unordered_map<uint64_t, const dbcppp::IMessage*> messages_;  // key of the map is dbc_id
+  IdLookupTable<MessageEntry> messages_;  // key is dbc_id
 
   // PJ
   PJ::PlotDataMapRef& data_map_;
+  std::mutex* series_mutex_ = nullptr;
 
   // N2k specialization
-  std::set<uint32_t> fast_packet_pgns_set_;
   std::unordered_map<uint32_t, std::unique_ptr<N2kMsgFast>> fast_packets_map_;  // key of the map is the frame_id
   std::unique_ptr<N2kMsgFast> null_n2k_fast_ptr_ = nullptr;
 
+  // ISO-TP specialization, key of the map is the frame_id
+  std::unordered_map<uint32_t, IsoTpSession> isotp_sessions_;
+  double isotp_timeout_ = 1.0;
+
   // extended frame id flag
   bool is_extended_id_ = false;
-  // CAN frame filter
-  std::unordered_map<std::string, QRegularExpression> m_filter_list;
+  // CAN frame filter on message and signal names
+  NameMatcher name_matcher_;
+  NameMatcher signal_include_;
+  NameMatcher signal_exclude_;
+  std::unordered_map<uint32_t, FrameBatch> batches_;  // key of the map is the frame_id
+  std::vector<double> batch_values_;
+
+  // Series cache, key of the map is the series name
+  std::unordered_map<std::string, SeriesState> series_;
+  // Interned series, valid until the decode tables change since keys hold signal indexes
+  std::unordered_map<uint64_t, SeriesState*> series_handles_;
+  bool change_only_ = false;
+  double change_only_deadband_ = 0.0;
+  double change_only_max_hold_ = 0.0;
+  bool deferred_storage_ = false;
+  // Series with deferred samples, and statistics samples waiting for mergeDeferredSamples()
+  std::vector<SeriesState*> deferred_series_;
+  std::vector<std::pair<PJ::PlotData*, PJ::PlotData::Point>> deferred_statistics_;
+  std::unordered_set<std::string> series_selection_;
+  RetentionPolicy retention_;
+  size_t tier_factor_ = 0;
+  size_t tier_levels_ = 0;
+
+  // Filtering and statistics
+  std::unordered_set<uint64_t> id_filter_;
+  Counters counters_;
+  std::unordered_map<uint32_t, uint64_t> unknown_id_counts_;
+  struct DecodeTiming
+  {
+    uint64_t frames = 0;
+    uint64_t decode_ns = 0;
+    uint64_t interval_frames = 0;
+    uint64_t interval_decode_ns = 0;
+  };
+  std::unordered_map<const dbcppp::IMessage*, DecodeTiming> message_timings_;
+  double statistics_interval_ = 0.0;
+  std::string statistics_prefix_ = "can_stats/";
+  double last_statistics_ts_ = 0.0;
 
 };
+
+// Everything decoding looks up in the database, built from a DBC in one go
+struct CanFrameProcessor::DecodeTables
+{
+  std::unique_ptr<dbcppp::INetwork> network;
+  IdLookupTable<MessageEntry> messages;  // key is the frame id in RAW mode, otherwise the PGN
+  bool is_extended_id = false;
+};
 #endif  // CAN_FRAME_PROCESSOR_H_
@@ -0,0 +1,83 @@
+#include <QtGlobal>
+#include <QDebug>
+#include <QFileInfo>
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+
+#include "CanLogFollower.h"
+
+CanLogFollower::CanLogFollower(const QString& filename, qint64 max_read_bytes)
+  : filename_{ filename }, file_{ filename }, max_read_bytes_{ max_read_bytes }
+{
+  // Unbuffered, so that reads past the previous end of file see the appended bytes
+  if (!file_.open(QFile::ReadOnly | QFile::Unbuffered))
+  {
+    qDebug() << "Cannot open" << filename << "to follow it";
+    return;
+  }
+  watcher_.addPath(filename_);
+  QObject::connect(&watcher_, &QFileSystemWatcher::fileChanged, [this]() {
+    // A log rotated by the writer is removed from the watcher, follow the new file
+    if (!watcher_.files().contains(filename_) && QFile::exists(filename_))
+    {
+      watcher_.addPath(filename_);
+    }
+    changed_ = true;
+  });
+}
+
+bool CanLogFollower::isReplaced() const
+{
+#ifndef Q_OS_WIN
+  // Another inode at the path, e.g. a rotated log that was recreated, even one already larger than offset_.
+  // While the path is missing the open file is still read to its end.
+  struct stat open_stat, path_stat;
+  if (::fstat(file_.handle(), &open_stat) != 0 || ::stat(filename_.toLocal8Bit().constData(), &path_stat) != 0)
+  {
+    return false;
+  }
+  return open_stat.st_ino != path_stat.st_ino || open_stat.st_dev != path_stat.st_dev;
+#else
+  // An open file cannot be renamed on Windows, but the path may name a smaller file than the open one.
+  // The path is queried first, appends in between only make the open file larger.
+  const QFileInfo path_info(filename_);
+  return path_info.exists() && path_info.size() < file_.size();
+#endif
+}
+
+QByteArray CanLogFollower::readCompleteLines()
+{
+  qint64 size = file_.size();
+  if (size < offset_ || isReplaced())
+  {
+    // Truncated or replaced, start over from the beginning of the file at the path
+    file_.close();
+    if (!file_.open(QFile::ReadOnly | QFile::Unbuffered))
+    {
+      return QByteArray();
+    }
+    offset_ = 0;
+    partial_.clear();
+    size = file_.size();
+  }
+  const qint64 available = std::min(size - offset_, max_read_bytes_);
+  if (available <= 0 || !file_.seek(offset_))
+  {
+    return QByteArray();
+  }
+  QByteArray data = partial_ + file_.read(available);
+  offset_ += data.size() - partial_.size();
+  if (offset_ < size)
+  {
+    // The rest is read by the next call
+    changed_ = true;
+  }
+  const int line_end = data.lastIndexOf('\n') + 1;
+  partial_ = data.mid(line_end);
+  data.truncate(line_end);
+  return data;
+}
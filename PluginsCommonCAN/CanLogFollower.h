@@ -0,0 +1,74 @@
+#ifndef CAN_LOG_FOLLOWER_H_
+#define CAN_LOG_FOLLOWER_H_
+
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QString>
+
+#include <atomic>
+
+#include "CandumpLine.h"
+
+// Follows a candump -L log while it is written, e.g. by `candump -L can0 > drive.log`. The file stays
+// open and only the bytes appended since the last read are parsed, a partial last line is kept until
+// its end arrives. Growth is signalled by QFileSystemWatcher (inotify on Linux), nothing is read while
+// the file does not change. Create it in the GUI thread, readAppended() may be called from any thread.
+class CanLogFollower
+{
+public:
+  static const qint64 DEFAULT_READ_BYTES = 1024 * 1024;
+
+  explicit CanLogFollower(const QString& filename, qint64 max_read_bytes = DEFAULT_READ_BYTES);
+
+  bool isOpen() const
+  {
+    return file_.isOpen();
+  }
+
+  // Calls func(record) for every frame of the complete lines appended since the last call, reading at
+  // most max_read_bytes per call. Returns the number of frames.
+  template <typename Func>
+  size_t readAppended(bool fd_format, Func func)
+  {
+    if (!changed_.exchange(false))
+    {
+      return 0;
+    }
+    const QByteArray lines = readCompleteLines();
+    size_t frames = 0;
+    RawFrameRecord record;
+    for (int start = 0; start < lines.size();)
+    {
+      int end = lines.indexOf('\n', start);
+      const int next = end + 1;
+      if (end > start && lines[end - 1] == '\r')
+      {
+        end--;
+      }
+      if (parseCandumpLine(QString::fromLatin1(lines.constData() + start, end - start), fd_format, record))
+      {
+        func(record);
+        frames++;
+      }
+      start = next;
+    }
+    return frames;
+  }
+
+private:
+  // The path names another file than the open one, the writer has rotated the log
+  bool isReplaced() const;
+  // Appended data up to the last line feed, the rest is kept in partial_
+  QByteArray readCompleteLines();
+
+  QString filename_;
+  QFile file_;
+  QFileSystemWatcher watcher_;
+  qint64 max_read_bytes_;
+  qint64 offset_ = 0;
+  QByteArray partial_;
+  // Set by the watcher, the existing content is read on the first call
+  std::atomic<bool> changed_{ true };
+};
+
+#endif  // CAN_LOG_FOLLOWER_H_
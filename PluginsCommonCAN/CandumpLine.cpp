@@ -0,0 +1,57 @@
+#include <QByteArray>
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <cstring>
+
+#include "CandumpLine.h"
+
+namespace
+{
+// Regular expression for log files created by candump -L
+// Captured groups: time, channel, frame_id, payload, and R for remote requests
+const QRegularExpression canlog_rgx("\\((?<time>\\d*\\.\\d*)\\)\\s*(?<can_channel>[\\S]*)\\s*(?<id>[0-9a-fA-F]{3,8})\\#(?<data>[0-9a-fA-F]*)(?<rtr>R?)");
+const QRegularExpression canfd_log_rgx("\\((?<time>\\d*\\.\\d*)\\)\\s*(?<can_channel>[\\S]*)\\s*(?<id>[0-9a-fA-F]{3,8})\\#(?<flag>\\#[0-1])(?<data>[0-9a-fA-F]*)");
+// candump writes error frames with CAN_ERR_FLAG set in the 8 digit id
+const uint32_t CAN_ERR_FLAG = 0x20000000;
+const uint32_t CAN_EFF_MASK = 0x1FFFFFFF;
+}  // namespace
+
+bool parseCandumpLine(const QString& line, bool fd_format, RawFrameRecord& record)
+{
+  QRegularExpressionMatchIterator rxIterator;
+  if (!fd_format)
+  {
+    rxIterator = canlog_rgx.globalMatch(line);
+  }
+  else
+  {
+    rxIterator = canfd_log_rgx.globalMatch(line);
+  }
+  if (!rxIterator.hasNext())
+  {
+    return false;
+  }
+  QRegularExpressionMatch canFrame = rxIterator.next();
+  // QString conversions ignore the locale, the streamer cannot switch it like the loader does
+  record.frame_id = canFrame.captured("id").toUInt(nullptr, 16);
+  record.timestamp_secs = canFrame.captured("time").toDouble();
+
+  // candump writes 8 hex digits for extended ids and ##<flags> for CAN FD frames, bit 0 being BRS
+  record.flags = canFrame.capturedLength("id") > 3 ? RawFrameRecord::EXTENDED_ID : 0;
+  if (canFrame.capturedLength("flag") > 0)
+  {
+    record.flags |= RawFrameRecord::FLEXIBLE_DATA_RATE;
+    record.flags |= canFrame.captured("flag") == "#1" ? RawFrameRecord::BITRATE_SWITCH : 0;
+  }
+  record.flags |= canFrame.capturedLength("rtr") > 0 ? RawFrameRecord::REMOTE_REQUEST : 0;
+  if ((record.flags & RawFrameRecord::EXTENDED_ID) && (record.frame_id & CAN_ERR_FLAG))
+  {
+    record.flags |= RawFrameRecord::ERROR_FRAME;
+    record.frame_id &= CAN_EFF_MASK;
+  }
+  record.data_len = uint8_t(std::min(canFrame.capturedLength("data") / 2, int(sizeof(record.data))));
+  QByteArray buffer = QByteArray::fromHex(canFrame.captured("data").toUtf8());
+  memcpy(record.data, buffer.data(), record.data_len);
+  return true;
+}
@@ -0,0 +1,13 @@
+#ifndef CANDUMP_LINE_H_
+#define CANDUMP_LINE_H_
+
+#include <QString>
+
+#include "RawFrameArchive.h"
+
+// Parses a line of a log written by candump -L, "(<time>) <interface> <id>#<data>". With fd_format
+// the CAN FD syntax "<id>##<flags><data>" is expected instead. Remote requests ("<id>#R") and error
+// frames are flagged in the record. Returns false for other lines.
+bool parseCandumpLine(const QString& line, bool fd_format, RawFrameRecord& record);
+
+#endif  // CANDUMP_LINE_H_
@@ -0,0 +1,170 @@
+#ifndef ID_LOOKUP_TABLE_H_
+#define ID_LOOKUP_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Map from CAN ids or PGNs to values stored inline, for lookups on every received frame.
+// Keys below 2048 (all standard ids) index a direct array, other keys go into an open addressing
+// table with linear probing kept at most half full. A hit touches a single slot, no node is chased.
+// Lookups never allocate; inserting and erasing rebuilds slots and is meant for setup only.
+template <typename T>
+class IdLookupTable
+{
+public:
+  static const uint32_t DIRECT_SIZE = 2048;
+
+  // Inserts the value, or replaces the one stored for the key
+  void insert(uint32_t key, T value)
+  {
+    if (key < DIRECT_SIZE)
+    {
+      if (direct_.empty())
+      {
+        direct_.resize(DIRECT_SIZE);
+      }
+      Slot& slot = direct_[key];
+      size_ += slot.used ? 0 : 1;
+      slot = Slot{ key, true, std::move(value) };
+      return;
+    }
+    if ((hashed_size_ + 1) * 2 > hashed_.size())
+    {
+      rehash(hashed_.empty() ? 16 : hashed_.size() * 2);
+    }
+    Slot& slot = hashed_[probe(key)];
+    if (!slot.used)
+    {
+      size_++;
+      hashed_size_++;
+    }
+    slot = Slot{ key, true, std::move(value) };
+  }
+
+  T* find(uint32_t key)
+  {
+    return const_cast<T*>(static_cast<const IdLookupTable*>(this)->find(key));
+  }
+
+  const T* find(uint32_t key) const
+  {
+    if (key < DIRECT_SIZE)
+    {
+      return !direct_.empty() && direct_[key].used ? &direct_[key].value : nullptr;
+    }
+    if (hashed_.empty())
+    {
+      return nullptr;
+    }
+    const Slot& slot = hashed_[probe(key)];
+    return slot.used ? &slot.value : nullptr;
+  }
+
+  // Calls func(key, value) for every entry
+  template <typename Func>
+  void forEach(Func func)
+  {
+    for (Slot& slot : direct_)
+    {
+      if (slot.used)
+      {
+        func(slot.key, slot.value);
+      }
+    }
+    for (Slot& slot : hashed_)
+    {
+      if (slot.used)
+      {
+        func(slot.key, slot.value);
+      }
+    }
+  }
+
+  // Removes the entries for which pred(key, value) returns true
+  template <typename Pred>
+  void eraseIf(Pred pred)
+  {
+    for (Slot& slot : direct_)
+    {
+      if (slot.used && pred(slot.key, slot.value))
+      {
+        slot = Slot();
+        size_--;
+      }
+    }
+    // Probe chains cannot have holes, the remaining entries are inserted again
+    std::vector<Slot> remaining;
+    for (Slot& slot : hashed_)
+    {
+      if (slot.used && !pred(slot.key, slot.value))
+      {
+        remaining.push_back(std::move(slot));
+      }
+    }
+    size_ -= hashed_size_ - remaining.size();
+    hashed_size_ = remaining.size();
+    hashed_.assign(hashed_.size(), Slot());
+    for (Slot& slot : remaining)
+    {
+      hashed_[probe(slot.key)] = std::move(slot);
+    }
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+private:
+  struct Slot
+  {
+    uint32_t key = 0;
+    bool used = false;
+    T value = T();
+  };
+
+  // Index of the slot holding the key, or of the empty slot where it would be inserted
+  size_t probe(uint32_t key) const
+  {
+    const size_t mask = hashed_.size() - 1;
+    // Fibonacci hashing, the high bits of the product spread ids and PGNs sharing their low byte
+    size_t index = uint32_t(key * 2654435769u) >> hash_shift_;
+    while (hashed_[index].used && hashed_[index].key != key)
+    {
+      index = (index + 1) & mask;
+    }
+    return index;
+  }
+
+  void rehash(size_t capacity)
+  {
+    std::vector<Slot> previous(capacity);
+    previous.swap(hashed_);
+    hash_shift_ = 32;
+    for (size_t size = capacity; size > 1; size /= 2)
+    {
+      hash_shift_--;
+    }
+    for (Slot& slot : previous)
+    {
+      if (slot.used)
+      {
+        hashed_[probe(slot.key)] = std::move(slot);
+      }
+    }
+  }
+
+  std::vector<Slot> direct_;  // allocated on the first key below DIRECT_SIZE
+  std::vector<Slot> hashed_;  // capacity is a power of two
+  size_t size_ = 0;
+  size_t hashed_size_ = 0;
+  uint32_t hash_shift_ = 32;
+};
+
+#endif  // ID_LOOKUP_TABLE_H_
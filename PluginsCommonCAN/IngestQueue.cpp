@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+
+#include "IngestQueue.h"
+
+IngestQueue::IngestQueue(PJ::PlotDataMapRef& data_map, size_t capacity, DropPolicy policy,
+                         CanFrameProcessor::CanProtocol protocol, double publish_interval_secs)
+  : data_map_{ data_map }
+  , capacity_{ std::max<size_t>(capacity, 1) }
+  , policy_{ policy }
+  , protocol_{ protocol }
+  , publish_interval_{ publish_interval_secs }
+{
+}
+
+void IngestQueue::setPriorityIds(const std::unordered_set<uint64_t>& priority_ids)
+{
+  priority_ids_.clear();
+  for (uint64_t id : priority_ids)
+  {
+    priority_ids_.insert(uint32_t(id));
+  }
+}
+
+bool IngestQueue::isPriority(const uint32_t frame_id) const
+{
+  if (priority_ids_.empty())
+  {
+    return false;
+  }
+  const uint32_t key = protocol_ == CanFrameProcessor::RAW ? frame_id & 0x1FFFFFFF : PGN_FROM_FRAME_ID(frame_id);
+  return priority_ids_.count(key) > 0;
+}
+
+void IngestQueue::push(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len, const uint8_t flags,
+                       const double timestamp_secs)
+{
+  if (counters_.frames_in++ == 0)
+  {
+    last_publish_ts_ = timestamp_secs;
+  }
+  last_timestamp_ = timestamp_secs;
+
+  std::vector<QueuedFrame>* priority_queue = nullptr;
+  if (isPriority(frame_id))
+  {
+    counters_.priority_frames++;
+    priority_queue = &priority_frames_;
+  }
+  else if (policy_ == DECIMATE_PER_ID)
+  {
+    if (id_frames_[frame_id]++ % keep_every_ != 0)
+    {
+      counters_.frames_dropped++;
+      return;
+    }
+    if (frames_.size() >= capacity_)
+    {
+      decimate();
+    }
+  }
+  // Also the fallback of decimation when every queued frame has a different id
+  if (!priority_queue && frames_.size() >= capacity_)
+  {
+    frames_.pop_front();
+    counters_.frames_dropped++;
+  }
+
+  QueuedFrame& frame = priority_queue ? priority_queue->emplace_back() : frames_.emplace_back();
+  const size_t len = std::min(data_len, sizeof(frame.record.data));
+  frame.sequence = sequence_++;
+  frame.record.timestamp_secs = timestamp_secs;
+  frame.record.frame_id = frame_id;
+  frame.record.flags = flags;
+  frame.record.data_len = uint8_t(len);
+  std::memcpy(frame.record.data, data_ptr, len);
+  std::memset(frame.record.data + len, 0, sizeof(frame.record.data) - len);
+  interval_peak_ = std::max(interval_peak_, frames_.size() + priority_frames_.size());
+}
+
+void IngestQueue::setSourceLoss(const std::string& name, uint64_t total)
+{
+  source_losses_[name] = total;
+}
+
+void IngestQueue::decimate()
+{
+  keep_every_ *= 2;
+  interval_decimation_ = std::max(interval_decimation_, keep_every_);
+  // The frames of an id that remain queued are the ones at multiples of keep_every_
+  std::unordered_map<uint32_t, uint64_t> queued;
+  const size_t size_before = frames_.size();
+  frames_.erase(std::remove_if(frames_.begin(), frames_.end(),
+                               [&queued](const QueuedFrame& frame) { return queued[frame.record.frame_id]++ % 2 != 0; }),
+                frames_.end());
+  counters_.frames_dropped += size_before - frames_.size();
+}
+
+void IngestQueue::endCycle()
+{
+  frames_.clear();
+  priority_frames_.clear();
+  id_frames_.clear();
+  keep_every_ = 1;
+  if (counters_.frames_in > 0 && last_timestamp_ - last_publish_ts_ >= publish_interval_)
+  {
+    publish(last_timestamp_);
+  }
+}
+
+void IngestQueue::publish(double timestamp_secs)
+{
+  last_publish_ts_ = timestamp_secs;
+  getPlot("can_ingest/frames_in")->pushBack({ timestamp_secs, double(counters_.frames_in) });
+  getPlot("can_ingest/frames_dropped")->pushBack({ timestamp_secs, double(counters_.frames_dropped) });
+  getPlot("can_ingest/priority_frames")->pushBack({ timestamp_secs, double(counters_.priority_frames) });
+  // Largest number of frames queued in a cycle since the last publication
+  getPlot("can_ingest/peak_queue_frames")->pushBack({ timestamp_secs, double(interval_peak_) });
+  if (policy_ == DECIMATE_PER_ID)
+  {
+    getPlot("can_ingest/decimation")->pushBack({ timestamp_secs, double(interval_decimation_) });
+  }
+  for (const auto& [name, total] : source_losses_)
+  {
+    getPlot("can_ingest/" + name)->pushBack({ timestamp_secs, double(total) });
+  }
+  interval_peak_ = 0;
+  interval_decimation_ = 1;
+}
+
+PJ::PlotData* IngestQueue::getPlot(const std::string& name)
+{
+  auto plot_it = data_map_.numeric.find(name);
+  if (plot_it == data_map_.numeric.end())
+  {
+    plot_it = data_map_.addNumeric(name);
+  }
+  return &plot_it->second;
+}
@@ -0,0 +1,110 @@
+#ifndef INGEST_QUEUE_H_
+#define INGEST_QUEUE_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <PlotJuggler/plotdata.h>
+
+#include "CanFrameProcessor.h"
+#include "RawFrameArchive.h"
+
+// Bounded queue between the CAN interface and the decoder of a stream. The sources are emptied every
+// cycle, the frames read are queued, at most `capacity` of them, and handed to the decoder by drain().
+// When more frames arrive the drop policy decides which are lost, frames of the priority ids are never
+// dropped. The drop counters are published as can_ingest/... series, with the losses of the sources.
+class IngestQueue
+{
+public:
+  enum DropPolicy
+  {
+    DROP_OLDEST,     // the newest frames are kept
+    DECIMATE_PER_ID  // every id keeps one frame in 2^k, k grows each time the queue fills up
+  };
+  struct Counters
+  {
+    uint64_t frames_in = 0;
+    uint64_t frames_dropped = 0;
+    uint64_t priority_frames = 0;
+  };
+
+  IngestQueue(PJ::PlotDataMapRef& data_map, size_t capacity, DropPolicy policy,
+              CanFrameProcessor::CanProtocol protocol, double publish_interval_secs = 1.0);
+
+  // Priority ids are frame ids in RAW mode, PGNs otherwise. Keep the list short: priority frames are
+  // queued besides the bound.
+  void setPriorityIds(const std::unordered_set<uint64_t>& priority_ids);
+
+  void push(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len, const uint8_t flags,
+            const double timestamp_secs);
+  // Running total of what a source lost before it was read, e.g. frames a ring producer could not
+  // write, published as can_ingest/<name>
+  void setSourceLoss(const std::string& name, uint64_t total);
+
+  // Calls func(record) for every frame kept in this cycle, in arrival order, and empties the queue
+  template <typename Func>
+  void drain(Func func)
+  {
+    auto frame_it = frames_.begin();
+    auto priority_it = priority_frames_.begin();
+    while (frame_it != frames_.end() || priority_it != priority_frames_.end())
+    {
+      if (priority_it == priority_frames_.end() ||
+          (frame_it != frames_.end() && frame_it->sequence < priority_it->sequence))
+      {
+        func((frame_it++)->record);
+      }
+      else
+      {
+        func((priority_it++)->record);
+      }
+    }
+    endCycle();
+  }
+
+  const Counters& counters() const
+  {
+    return counters_;
+  }
+
+private:
+  struct QueuedFrame
+  {
+    uint64_t sequence;
+    RawFrameRecord record;
+  };
+  bool isPriority(const uint32_t frame_id) const;
+  // Drops every other queued frame of each id
+  void decimate();
+  void endCycle();
+  void publish(double timestamp_secs);
+  PJ::PlotData* getPlot(const std::string& name);
+
+  PJ::PlotDataMapRef& data_map_;
+  size_t capacity_;
+  DropPolicy policy_;
+  CanFrameProcessor::CanProtocol protocol_;
+  double publish_interval_;
+  std::unordered_set<uint32_t> priority_ids_;
+
+  std::deque<QueuedFrame> frames_;
+  std::vector<QueuedFrame> priority_frames_;
+  uint64_t sequence_ = 0;
+  // Decimation state of the current cycle
+  std::unordered_map<uint32_t, uint64_t> id_frames_;
+  uint64_t keep_every_ = 1;
+
+  Counters counters_;
+  std::map<std::string, uint64_t> source_losses_;
+  double last_timestamp_ = 0.0;
+  double last_publish_ts_ = 0.0;
+  bool published_ = false;
+  size_t interval_peak_ = 0;
+  uint64_t interval_decimation_ = 1;
+};
+
+#endif  // INGEST_QUEUE_H_
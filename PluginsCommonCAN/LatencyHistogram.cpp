@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <chrono>
+
+#include "LatencyHistogram.h"
+
+namespace
+{
+// Upper bounds of the buckets in milliseconds, the last bucket has none
+const double BUCKET_BOUNDS_MS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+const size_t BUCKET_COUNT = sizeof(BUCKET_BOUNDS_MS) / sizeof(BUCKET_BOUNDS_MS[0]) + 1;
+
+std::string bucketName(size_t bucket)
+{
+  if (bucket + 1 == BUCKET_COUNT)
+  {
+    return "can_trace/latency_hist/over_" + std::to_string(int(BUCKET_BOUNDS_MS[bucket - 1])) + "ms";
+  }
+  const int lower = bucket == 0 ? 0 : int(BUCKET_BOUNDS_MS[bucket - 1]);
+  return "can_trace/latency_hist/" + std::to_string(lower) + "_" + std::to_string(int(BUCKET_BOUNDS_MS[bucket])) +
+         "ms";
+}
+
+double percentile(std::vector<double>& values, double fraction)
+{
+  auto nth = values.begin() + size_t(fraction * double(values.size() - 1));
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+}  // namespace
+
+LatencyHistogram::LatencyHistogram(PJ::PlotDataMapRef& data_map, double publish_interval_secs)
+  : data_map_{ data_map }, publish_interval_{ publish_interval_secs }, bucket_frames_(BUCKET_COUNT, 0)
+{
+}
+
+void LatencyHistogram::endCycle()
+{
+  const double now_secs =
+      std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+  for (double timestamp_secs : cycle_timestamps_)
+  {
+    const double latency_ms = (now_secs - timestamp_secs) * 1e3;
+    const size_t bucket =
+        std::upper_bound(std::begin(BUCKET_BOUNDS_MS), std::end(BUCKET_BOUNDS_MS), latency_ms) -
+        std::begin(BUCKET_BOUNDS_MS);
+    bucket_frames_[bucket]++;
+    interval_latencies_ms_.push_back(latency_ms);
+  }
+  cycle_timestamps_.clear();
+  if (last_publish_secs_ == 0.0)
+  {
+    last_publish_secs_ = now_secs;
+  }
+  else if (now_secs - last_publish_secs_ >= publish_interval_)
+  {
+    publish(now_secs);
+  }
+}
+
+void LatencyHistogram::publish(double now_secs)
+{
+  last_publish_secs_ = now_secs;
+  for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+  {
+    getPlot(bucketName(bucket))->pushBack({ now_secs, double(bucket_frames_[bucket]) });
+    bucket_frames_[bucket] = 0;
+  }
+  if (!interval_latencies_ms_.empty())
+  {
+    getPlot("can_trace/latency_ms/p50")->pushBack({ now_secs, percentile(interval_latencies_ms_, 0.5) });
+    getPlot("can_trace/latency_ms/p99")->pushBack({ now_secs, percentile(interval_latencies_ms_, 0.99) });
+    getPlot("can_trace/latency_ms/max")->pushBack(
+        { now_secs, *std::max_element(interval_latencies_ms_.begin(), interval_latencies_ms_.end()) });
+  }
+  interval_latencies_ms_.clear();
+}
+
+PJ::PlotData* LatencyHistogram::getPlot(const std::string& name)
+{
+  auto plot_it = data_map_.numeric.find(name);
+  if (plot_it == data_map_.numeric.end())
+  {
+    plot_it = data_map_.addNumeric(name);
+  }
+  return &plot_it->second;
+}
@@ -0,0 +1,37 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <string>
+#include <vector>
+
+#include <PlotJuggler/plotdata.h>
+
+// Latency from the timestamp of a frame to the merge of its samples into the data map of the plot,
+// published as can_trace/... series: per bucket the frames of the last interval, and the median, 99th
+// percentile and maximum in milliseconds. Frame timestamps must come from the system clock, as those of
+// SocketCAN and of most UDP and shared memory producers; the latency of a followed log is meaningless.
+class LatencyHistogram
+{
+public:
+  explicit LatencyHistogram(PJ::PlotDataMapRef& data_map, double publish_interval_secs = 1.0);
+
+  void addFrame(double timestamp_secs)
+  {
+    cycle_timestamps_.push_back(timestamp_secs);
+  }
+  // The frames added since the last call have reached the plot. Call with the lock of the data map held.
+  void endCycle();
+
+private:
+  void publish(double now_secs);
+  PJ::PlotData* getPlot(const std::string& name);
+
+  PJ::PlotDataMapRef& data_map_;
+  double publish_interval_;
+  std::vector<double> cycle_timestamps_;
+  std::vector<double> interval_latencies_ms_;
+  std::vector<uint64_t> bucket_frames_;
+  double last_publish_secs_ = 0.0;
+};
+
+#endif  // LATENCY_HISTOGRAM_H_
@@ -0,0 +1,54 @@
+#ifndef MIN_MAX_BUCKET_H_
+#define MIN_MAX_BUCKET_H_
+
+#include <PlotJuggler/plotdata.h>
+
+// Collects the minimum and maximum of a fixed number of consecutive samples
+struct MinMaxBucket
+{
+  size_t count = 0;
+  PJ::PlotData::Point min;
+  PJ::PlotData::Point max;
+
+  // Returns true once factor samples have been collected
+  bool add(const PJ::PlotData::Point& point, size_t factor)
+  {
+    include(point, count == 0);
+    return ++count >= factor;
+  }
+
+  // Adds the extremes taken from a full bucket of a finer level as a single unit, so that a bucket
+  // fed this way covers factor buckets of that level. Returns true once factor units have been added.
+  bool addExtremes(const PJ::PlotData::Point extremes[2], size_t extremes_count, size_t factor)
+  {
+    for (size_t i = 0; i < extremes_count; i++)
+    {
+      include(extremes[i], count == 0 && i == 0);
+    }
+    return ++count >= factor;
+  }
+
+  void include(const PJ::PlotData::Point& point, bool first)
+  {
+    if (first || point.y < min.y)
+    {
+      min = point;
+    }
+    if (first || point.y > max.y)
+    {
+      max = point;
+    }
+  }
+
+  // Writes both extremes in time order (one sample if they coincide) and empties the bucket
+  size_t take(PJ::PlotData::Point out[2])
+  {
+    const bool min_first = min.x <= max.x;
+    out[0] = min_first ? min : max;
+    out[1] = min_first ? max : min;
+    count = 0;
+    return min.x == max.x ? 1 : 2;
+  }
+};
+
+#endif  // MIN_MAX_BUCKET_H_
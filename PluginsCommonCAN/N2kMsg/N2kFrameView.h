@@ -0,0 +1,71 @@
+#ifndef N2K_FRAME_VIEW_H_
+#define N2K_FRAME_VIEW_H_
+
+#include <cstring>
+#include "N2kMsgInterface.h"
+
+// Non-owning view of a single NMEA2K/J1939 frame over the caller's buffer. The header fields are
+// extracted from the 29 bit id inline, without virtual calls, and the payload is not copied. Like the
+// RAW decoding path, the signal decoders read whole 64 bit words: the buffer must hold at least 8
+// readable bytes, the bytes past the DLC may hold anything.
+struct N2kFrameView
+{
+  // Size of a payload padded by Padded(), the largest CAN FD payload plus one decoder word
+  static constexpr size_t PADDED_SIZE = 64 + 8;
+
+  constexpr N2kFrameView(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
+                         const double timestamp_secs)
+    : frame_id_{ frame_id }, data_ptr_{ data_ptr }, data_len_{ data_len }, timestamp_secs_{ timestamp_secs }
+  {
+  }
+  constexpr uint32_t GetFrameId() const
+  {
+    return frame_id_;
+  }
+  constexpr uint32_t GetPgn() const
+  {
+    return PGN_FROM_FRAME_ID(frame_id_);
+  }
+  constexpr size_t GetDataLen() const
+  {
+    return data_len_;
+  }
+  constexpr uint32_t GetSourceAddr() const
+  {
+    return frame_id_ & 0xFF;
+  }
+  constexpr uint32_t GetPduFormat() const
+  {
+    return (frame_id_ >> 16) & 0xFF;
+  }
+  constexpr uint32_t GetPduSpecific() const
+  {
+    return (frame_id_ >> 8) & 0xFF;
+  }
+  constexpr const uint8_t* GetDataPtr() const
+  {
+    return data_ptr_;
+  }
+  constexpr double GetTimeStamp() const
+  {
+    return timestamp_secs_;
+  }
+
+  // View of the payload copied into buffer and padded with 0xFF, the J1939 "not available" value. Only
+  // needed when a decoded signal reads past the DLC.
+  N2kFrameView Padded(uint8_t (&buffer)[PADDED_SIZE]) const
+  {
+    const size_t len = data_len_ > PADDED_SIZE ? PADDED_SIZE : data_len_;
+    memcpy(buffer, data_ptr_, len);
+    memset(buffer + len, 0xFF, PADDED_SIZE - len);
+    return N2kFrameView(frame_id_, buffer, len, timestamp_secs_);
+  }
+
+private:
+  uint32_t frame_id_;
+  const uint8_t* data_ptr_;
+  size_t data_len_;
+  double timestamp_secs_;
+};
+
+#endif  // N2K_FRAME_VIEW_H_
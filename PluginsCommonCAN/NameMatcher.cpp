@@ -0,0 +1,179 @@
+#include <QDebug>
+
+#include <algorithm>
+#include <cctype>
+#include <queue>
+#include <sstream>
+
+#include "NameMatcher.h"
+
+namespace
+{
+// Plain ASCII patterns without regular expression syntax go into the automaton
+bool isLiteral(const std::string& pattern)
+{
+  for (char c : pattern)
+  {
+    if (static_cast<uint8_t>(c) >= 128)
+    {
+      return false;
+    }
+  }
+  return pattern.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
+uint8_t foldCase(char c)
+{
+  const uint8_t byte = static_cast<uint8_t>(c);
+  return byte < 128 ? static_cast<uint8_t>(std::tolower(byte)) : byte;
+}
+}  // namespace
+
+NameMatcher::NameMatcher(const std::vector<std::string>& patterns)
+{
+  std::vector<std::string> literals;
+  QStringList expressions;
+  for (const std::string& pattern : patterns)
+  {
+    if (pattern.empty())
+    {
+      continue;
+    }
+    if (isLiteral(pattern))
+    {
+      literals.push_back(pattern);
+      continue;
+    }
+    const QString expression = QString::fromStdString(pattern);
+    // An invalid pattern would invalidate the whole alternation, it matches nothing instead
+    if (!QRegularExpression(expression).isValid())
+    {
+      qDebug() << "Ignoring invalid filter pattern" << expression;
+      continue;
+    }
+    expressions.push_back("(?:" + expression + ")");
+  }
+  if (!literals.empty())
+  {
+    buildAutomaton(literals);
+  }
+  if (!expressions.empty())
+  {
+    regex_ = QRegularExpression(expressions.join('|'), QRegularExpression::CaseInsensitiveOption);
+    regex_.optimize();
+    has_regex_ = true;
+  }
+}
+
+void NameMatcher::buildAutomaton(const std::vector<std::string>& literals)
+{
+  std::array<int32_t, ALPHABET> no_transitions;
+  no_transitions.fill(-1);
+  next_.assign(1, no_transitions);
+  accepting_.assign(1, false);
+
+  // Trie of the lowercased patterns
+  for (const std::string& literal : literals)
+  {
+    int32_t state = 0;
+    for (char c : literal)
+    {
+      const uint8_t byte = foldCase(c);
+      if (next_[state][byte] < 0)
+      {
+        next_[state][byte] = int32_t(next_.size());
+        next_.push_back(no_transitions);
+        accepting_.push_back(false);
+      }
+      state = next_[state][byte];
+    }
+    accepting_[state] = true;
+  }
+
+  // Breadth first, missing transitions are replaced by the ones of the failure state
+  std::vector<int32_t> failure(next_.size(), 0);
+  std::queue<int32_t> pending;
+  for (auto& target : next_[0])
+  {
+    if (target < 0)
+    {
+      target = 0;
+    }
+    else
+    {
+      pending.push(target);
+    }
+  }
+  while (!pending.empty())
+  {
+    const int32_t state = pending.front();
+    pending.pop();
+    // A state accepts if a pattern ends at one of its suffixes
+    if (accepting_[failure[state]])
+    {
+      accepting_[state] = true;
+    }
+    for (size_t byte = 0; byte < ALPHABET; byte++)
+    {
+      int32_t& target = next_[state][byte];
+      if (target < 0)
+      {
+        target = next_[failure[state]][byte];
+      }
+      else
+      {
+        failure[target] = next_[failure[state]][byte];
+        pending.push(target);
+      }
+    }
+  }
+  has_literals_ = accepting_[0] || next_.size() > 1;
+}
+
+bool NameMatcher::matches(const std::string& name) const
+{
+  if (has_literals_)
+  {
+    if (accepting_[0])
+    {
+      return true;
+    }
+    int32_t state = 0;
+    for (char c : name)
+    {
+      const uint8_t byte = foldCase(c);
+      state = byte < ALPHABET ? next_[state][byte] : 0;
+      if (accepting_[state])
+      {
+        return true;
+      }
+    }
+  }
+  return has_regex_ && regex_.match(QString::fromStdString(name)).hasMatch();
+}
+
+std::vector<std::string> NameMatcher::splitPatterns(const std::string& list)
+{
+  std::vector<std::string> patterns;
+  std::stringstream ss(list);
+  std::string token;
+  while (std::getline(ss, token, ','))
+  {
+    token.erase(std::remove(token.begin(), token.end(), ' '), token.end());
+    if (!token.empty())
+    {
+      patterns.push_back(token);
+    }
+  }
+  return patterns;
+}
+
+std::string NameMatcher::joinPatterns(const std::vector<std::string>& patterns)
+{
+  std::string list;
+  for (const std::string& pattern : patterns)
+  {
+    list += list.empty() ? pattern : "," + pattern;
+  }
+  return list;
+}
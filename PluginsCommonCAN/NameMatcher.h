@@ -0,0 +1,42 @@
+#ifndef NAME_MATCHER_H_
+#define NAME_MATCHER_H_
+
+#include <QRegularExpression>
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Matches a name against a set of case insensitive patterns at once. Plain patterns are substrings
+// and are compiled into a single Aho-Corasick automaton, patterns using regular expression syntax
+// are joined into a single alternation. Each name is scanned once per kind, not once per pattern.
+class NameMatcher
+{
+public:
+  NameMatcher() = default;
+  explicit NameMatcher(const std::vector<std::string>& patterns);
+
+  bool empty() const
+  {
+    return !has_literals_ && !has_regex_;
+  }
+  // True if any pattern matches part of the name
+  bool matches(const std::string& name) const;
+
+  // Comma separated pattern lists as entered in the dialogs, spaces are removed
+  static std::vector<std::string> splitPatterns(const std::string& list);
+  static std::string joinPatterns(const std::vector<std::string>& patterns);
+
+private:
+  static const size_t ALPHABET = 128;  // bytes outside ASCII restart from the root
+  void buildAutomaton(const std::vector<std::string>& literals);
+
+  // Transitions of the automaton, complete so that matching never follows failure links
+  std::vector<std::array<int32_t, ALPHABET>> next_;
+  std::vector<bool> accepting_;
+  bool has_literals_ = false;
+  QRegularExpression regex_;
+  bool has_regex_ = false;
+};
+
+#endif  // NAME_MATCHER_H_
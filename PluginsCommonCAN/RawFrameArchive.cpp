@@ -0,0 +1,200 @@
+#include <QtGlobal>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "RawFrameArchive.h"
+
+namespace
+{
+const char ARCHIVE_MAGIC[8] = { 'P', 'J', 'C', 'A', 'N', 'R', 'A', 'W' };
+const uint32_t ARCHIVE_VERSION = 1;
+
+// An existing archive, e.g. of the previous connection, is renamed after its last modification time
+bool rotateExistingArchive(const QString& filename)
+{
+  const QFileInfo info(filename);
+  if (!info.exists())
+  {
+    return true;
+  }
+  const QString rotated = info.path() + "/" + info.completeBaseName() + "-" +
+                          info.lastModified().toString("yyyyMMdd-hhmmss") + "." + info.suffix();
+  if (QFile::exists(rotated) || !QFile::rename(filename, rotated))
+  {
+    qDebug() << "Cannot move the existing raw frame archive" << filename << "aside, not overwriting it";
+    return false;
+  }
+  qDebug() << "Moved the existing raw frame archive to" << rotated;
+  return true;
+}
+}  // namespace
+
+RawFrameArchiveWriter::~RawFrameArchiveWriter()
+{
+  close();
+}
+
+bool RawFrameArchiveWriter::open(const QString& filename, uint64_t capacity_frames, int sync_interval_ms)
+{
+  close();
+  if (capacity_frames == 0)
+  {
+    return false;
+  }
+  if (!rotateExistingArchive(filename))
+  {
+    return false;
+  }
+  file_.setFileName(filename);
+  mapping_size_ = qint64(sizeof(RawFrameArchiveHeader) + capacity_frames * sizeof(RawFrameRecord));
+  if (!file_.open(QFile::ReadWrite))
+  {
+    qDebug() << "Cannot create raw frame archive" << filename << file_.errorString();
+    return false;
+  }
+  // Reserve the disk space of the whole ring: a sparse file would only fail when append() first
+  // touches a page, with SIGBUS on a full disk
+#ifdef Q_OS_LINUX
+  const int error = posix_fallocate(file_.handle(), 0, mapping_size_);
+  const bool allocated = error == 0;
+  const QString error_string = allocated ? QString() : QString::fromLocal8Bit(strerror(error));
+#else
+  const bool allocated = file_.resize(mapping_size_);
+  const QString error_string = file_.errorString();
+#endif
+  if (!allocated)
+  {
+    qDebug() << "Cannot allocate raw frame archive" << filename << error_string;
+    file_.remove();
+    return false;
+  }
+  mapping_ = file_.map(0, mapping_size_);
+  if (!mapping_)
+  {
+    qDebug() << "Cannot map raw frame archive" << filename << file_.errorString();
+    file_.close();
+    return false;
+  }
+  header_ = reinterpret_cast<RawFrameArchiveHeader*>(mapping_);
+  records_ = reinterpret_cast<RawFrameRecord*>(mapping_ + sizeof(RawFrameArchiveHeader));
+  memcpy(header_->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+  header_->version = ARCHIVE_VERSION;
+  header_->record_size = sizeof(RawFrameRecord);
+  header_->capacity = capacity_frames;
+  header_->frames_written = 0;
+
+  stop_sync_ = false;
+  sync_thread_ = std::thread([this, sync_interval_ms]() { syncLoop(sync_interval_ms); });
+  return true;
+}
+
+void RawFrameArchiveWriter::close()
+{
+  if (sync_thread_.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(sync_mutex_);
+      stop_sync_ = true;
+    }
+    sync_cv_.notify_one();
+    sync_thread_.join();
+  }
+  if (mapping_)
+  {
+    syncMapping();
+    file_.unmap(mapping_);
+    mapping_ = nullptr;
+  }
+  header_ = nullptr;
+  records_ = nullptr;
+  file_.close();
+}
+
+void RawFrameArchiveWriter::syncLoop(int sync_interval_ms)
+{
+  std::unique_lock<std::mutex> lock(sync_mutex_);
+  while (!sync_cv_.wait_for(lock, std::chrono::milliseconds(sync_interval_ms), [this]() { return stop_sync_; }))
+  {
+    syncMapping();
+  }
+}
+
+void RawFrameArchiveWriter::syncMapping()
+{
+#ifdef Q_OS_WIN
+  FlushViewOfFile(mapping_, 0);
+#else
+  msync(mapping_, mapping_size_, MS_SYNC);
+#endif
+}
+
+bool RawFrameArchiveReader::open(const QString& filename)
+{
+  close();
+  file_.setFileName(filename);
+  if (!file_.open(QFile::ReadOnly) || file_.size() < qint64(sizeof(RawFrameArchiveHeader)))
+  {
+    return false;
+  }
+  const uchar* mapping = file_.map(0, file_.size());
+  if (!mapping)
+  {
+    return false;
+  }
+  RawFrameArchiveHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  if (memcmp(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0 || header.version != ARCHIVE_VERSION ||
+      header.record_size != sizeof(RawFrameRecord) || header.capacity == 0 ||
+      file_.size() < qint64(sizeof(RawFrameArchiveHeader) + header.capacity * sizeof(RawFrameRecord)))
+  {
+    qDebug() << "Invalid raw frame archive" << filename;
+    close();
+    return false;
+  }
+  records_ = reinterpret_cast<const RawFrameRecord*>(mapping + sizeof(RawFrameArchiveHeader));
+  capacity_ = header.capacity;
+  size_ = std::min(header.frames_written, header.capacity);
+  first_ = header.frames_written > header.capacity ? header.frames_written % header.capacity : 0;
+  return true;
+}
+
+void RawFrameArchiveReader::close()
+{
+  // Closing the file also unmaps it
+  file_.close();
+  records_ = nullptr;
+  capacity_ = first_ = size_ = 0;
+}
+
+uint64_t RawFrameArchiveReader::lowerBound(double timestamp_secs) const
+{
+  uint64_t low = 0;
+  uint64_t high = size_;
+  while (low < high)
+  {
+    const uint64_t mid = low + (high - low) / 2;
+    if (at(mid).timestamp_secs < timestamp_secs)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  return low;
+}
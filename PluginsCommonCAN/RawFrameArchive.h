@@ -0,0 +1,116 @@
+#ifndef RAW_FRAME_ARCHIVE_H_
+#define RAW_FRAME_ARCHIVE_H_
+
+#include <QFile>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+// File layout of a raw frame archive (.pjcan):
+//   RawFrameArchiveHeader, followed by `capacity` RawFrameRecord slots used as a ring.
+// Frame i (counted from the start of the recording) is in slot i % capacity, so the oldest frames
+// are overwritten once frames_written exceeds the capacity. All fields are little endian.
+struct RawFrameArchiveHeader
+{
+  char magic[8];  // "PJCANRAW"
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  uint64_t frames_written;
+};
+
+struct RawFrameRecord
+{
+  enum Flags : uint8_t
+  {
+    EXTENDED_ID = 0x01,
+    FLEXIBLE_DATA_RATE = 0x02,
+    BITRATE_SWITCH = 0x04,
+    REMOTE_REQUEST = 0x08,
+    ERROR_FRAME = 0x10
+  };
+  double timestamp_secs;
+  uint32_t frame_id;
+  uint8_t flags;
+  uint8_t data_len;
+  uint16_t reserved;
+  uint8_t data[64];
+};
+static_assert(sizeof(RawFrameArchiveHeader) == 32, "archive header layout changed");
+static_assert(sizeof(RawFrameRecord) == 80, "archive record layout changed");
+
+// Appends frames into a preallocated, memory mapped archive. append() is a copy into the mapping and
+// never blocks, the mapping is flushed to disk periodically by a background thread.
+class RawFrameArchiveWriter
+{
+public:
+  ~RawFrameArchiveWriter();
+
+  bool open(const QString& filename, uint64_t capacity_frames, int sync_interval_ms = 1000);
+  void close();
+  bool isOpen() const
+  {
+    return header_ != nullptr;
+  }
+
+  void append(double timestamp_secs, uint32_t frame_id, uint8_t flags, const uint8_t* data_ptr, size_t data_len)
+  {
+    RawFrameRecord& record = records_[header_->frames_written % header_->capacity];
+    record.timestamp_secs = timestamp_secs;
+    record.frame_id = frame_id;
+    record.flags = flags;
+    record.data_len = uint8_t(data_len > sizeof(record.data) ? sizeof(record.data) : data_len);
+    record.reserved = 0;
+    memcpy(record.data, data_ptr, record.data_len);
+    header_->frames_written++;
+  }
+
+private:
+  void syncLoop(int sync_interval_ms);
+  void syncMapping();
+
+  QFile file_;
+  uchar* mapping_ = nullptr;
+  qint64 mapping_size_ = 0;
+  RawFrameArchiveHeader* header_ = nullptr;
+  RawFrameRecord* records_ = nullptr;
+
+  std::thread sync_thread_;
+  std::mutex sync_mutex_;
+  std::condition_variable sync_cv_;
+  bool stop_sync_ = false;
+};
+
+// Read access to the frames of an archive, in recording order
+class RawFrameArchiveReader
+{
+public:
+  bool open(const QString& filename);
+  void close();
+
+  // Number of frames still stored in the ring
+  uint64_t size() const
+  {
+    return size_;
+  }
+  const RawFrameRecord& at(uint64_t index) const
+  {
+    return records_[(first_ + index) % capacity_];
+  }
+  // Index of the first frame at or after timestamp, frames are expected in time order
+  uint64_t lowerBound(double timestamp_secs) const;
+
+private:
+  QFile file_;
+  const RawFrameRecord* records_ = nullptr;
+  uint64_t capacity_ = 0;
+  uint64_t first_ = 0;
+  uint64_t size_ = 0;
+};
+
+#endif  // RAW_FRAME_ARCHIVE_H_
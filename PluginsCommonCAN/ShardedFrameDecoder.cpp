@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "ShardedFrameDecoder.h"
+#include "SpanTracer.h"
+
+ShardedFrameDecoder::ShardedFrameDecoder(const std::string& dbc_location, CanFrameProcessor::CanProtocol protocol,
+                                         PJ::PlotDataMapRef& data_map, std::mutex& data_map_mutex,
+                                         const std::unordered_map<std::string, QRegularExpression>& filter_list,
+                                         size_t shard_count)
+  : protocol_{ protocol }
+{
+  shard_count = std::max<size_t>(shard_count, 1);
+  for (size_t i = 0; i < shard_count; i++)
+  {
+    auto shard = std::make_unique<Shard>();
+    std::ifstream dbc_file{ dbc_location };
+    shard->processor = std::make_unique<CanFrameProcessor>(dbc_file, protocol, data_map, filter_list);
+    // Series are created in the data map while the plot may read it
+    shard->processor->setSeriesMutex(&data_map_mutex);
+    shard->processor->setDeferredStorage(true);
+    if (shard_count > 1)
+    {
+      shard->processor->setStatisticsPrefix("can_stats/shard" + std::to_string(i) + "/");
+    }
+    shards_.push_back(std::move(shard));
+  }
+  for (size_t i = 1; i < shards_.size(); i++)
+  {
+    Shard& shard = *shards_[i];
+    shard.worker = std::thread([this, &shard]() { workerLoop(shard); });
+  }
+}
+
+ShardedFrameDecoder::~ShardedFrameDecoder()
+{
+  {
+    std::lock_guard<std::mutex> lock(cycle_mutex_);
+    stopping_ = true;
+  }
+  cycle_started_.notify_all();
+  for (auto& shard : shards_)
+  {
+    if (shard->worker.joinable())
+    {
+      shard->worker.join();
+    }
+  }
+}
+
+void ShardedFrameDecoder::forEachProcessor(const std::function<void(CanFrameProcessor&)>& func)
+{
+  for (auto& shard : shards_)
+  {
+    func(*shard->processor);
+  }
+}
+
+void ShardedFrameDecoder::setIsoTpChannels(const std::vector<CanFrameProcessor::IsoTpChannel>& channels)
+{
+  shard_aliases_.clear();
+  for (const CanFrameProcessor::IsoTpChannel& channel : channels)
+  {
+    shard_aliases_[channel.response_id] = channel.request_id;
+  }
+  forEachProcessor([&](CanFrameProcessor& processor) { processor.setIsoTpChannels(channels); });
+}
+
+size_t ShardedFrameDecoder::shardIndex(const uint32_t frame_id) const
+{
+  // The priority bits are left out, so that all frames of a PGN from one source share a shard
+  uint32_t key = protocol_ == CanFrameProcessor::RAW ? frame_id & 0x1FFFFFFF : frame_id & 0x03FFFFFF;
+  if (!shard_aliases_.empty())
+  {
+    auto alias_it = shard_aliases_.find(key);
+    if (alias_it != shard_aliases_.end())
+    {
+      key = alias_it->second;
+    }
+  }
+  // Fibonacci hashing, neighbouring ids are spread over the shards
+  return size_t((uint64_t(uint32_t(key * 2654435769u)) * shards_.size()) >> 32);
+}
+
+void ShardedFrameDecoder::queueFrame(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len,
+                                     const uint8_t flags, const double timestamp_secs)
+{
+  RawFrameRecord& record = shards_[shardIndex(frame_id)]->frames.emplace_back();
+  const size_t len = std::min(data_len, sizeof(record.data));
+  record.timestamp_secs = timestamp_secs;
+  record.frame_id = frame_id;
+  record.flags = flags;
+  record.data_len = uint8_t(len);
+  std::memcpy(record.data, data_ptr, len);
+  std::memset(record.data + len, 0, sizeof(record.data) - len);
+}
+
+void ShardedFrameDecoder::decodeShard(Shard& shard)
+{
+  TraceSpan span("decode shard");
+  for (const RawFrameRecord& record : shard.frames)
+  {
+    // The record is zero padded to 64 bytes, the decoders may read whole words past the DLC
+    shard.processor->ProcessCanFrame(record.frame_id, record.data, record.data_len, record.timestamp_secs);
+  }
+  shard.frames.clear();
+}
+
+void ShardedFrameDecoder::decodeQueued()
+{
+  if (shards_.size() > 1)
+  {
+    {
+      std::lock_guard<std::mutex> lock(cycle_mutex_);
+      busy_workers_ = shards_.size() - 1;
+      cycle_++;
+    }
+    cycle_started_.notify_all();
+  }
+  decodeShard(*shards_[0]);
+  TraceSpan span("wait decoders");
+  std::unique_lock<std::mutex> lock(cycle_mutex_);
+  cycle_done_.wait(lock, [this]() { return busy_workers_ == 0; });
+}
+
+void ShardedFrameDecoder::mergeDecoded()
+{
+  TraceSpan span("merge");
+  for (auto& shard : shards_)
+  {
+    shard->processor->mergeDeferredSamples();
+  }
+}
+
+void ShardedFrameDecoder::workerLoop(Shard& shard)
+{
+  SpanTracer::setThreadName("decoder");
+  uint64_t cycle = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(cycle_mutex_);
+      cycle_started_.wait(lock, [this, cycle]() { return stopping_ || cycle_ != cycle; });
+      if (stopping_)
+      {
+        return;
+      }
+      cycle = cycle_;
+    }
+    decodeShard(shard);
+    {
+      std::lock_guard<std::mutex> lock(cycle_mutex_);
+      busy_workers_--;
+    }
+    cycle_done_.notify_one();
+  }
+}
+
+bool ShardedFrameDecoder::reloadDatabase(const std::string& dbc_location)
+{
+  // Every shard gets tables of its own, they are not shared between threads. Nothing is published
+  // before all are built, a file that cannot be parsed leaves every shard on the previous database.
+  auto tables = std::make_shared<ShardTables>();
+  for (auto& shard : shards_)
+  {
+    std::ifstream dbc_file{ dbc_location };
+    std::unique_ptr<CanFrameProcessor::DecodeTables> shard_tables = shard->processor->parseDatabase(dbc_file);
+    if (!shard_tables)
+    {
+      return false;
+    }
+    tables->push_back(std::move(shard_tables));
+  }
+  // A reload that was not adopted yet is replaced
+  std::atomic_store(&reloaded_tables_, tables);
+  return true;
+}
+
+bool ShardedFrameDecoder::applyReloadedDatabase()
+{
+  // Cheap check first, this is called every cycle
+  if (!std::atomic_load(&reloaded_tables_))
+  {
+    return false;
+  }
+  std::shared_ptr<ShardTables> tables = std::atomic_exchange(&reloaded_tables_, std::shared_ptr<ShardTables>());
+  if (!tables)
+  {
+    return false;
+  }
+  // No shard is decoding between cycles
+  for (size_t i = 0; i < shards_.size(); i++)
+  {
+    shards_[i]->processor->adoptDatabase(*(*tables)[i]);
+  }
+  return true;
+}
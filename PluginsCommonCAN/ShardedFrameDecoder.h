@@ -0,0 +1,88 @@
+#ifndef SHARDED_FRAME_DECODER_H_
+#define SHARDED_FRAME_DECODER_H_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CanFrameProcessor.h"
+#include "RawFrameArchive.h"
+
+// Decodes the frames of a stream on several threads. Frames are sharded by id, or by PGN and
+// addresses for NMEA2K and J1939, and every shard has its own CanFrameProcessor: the series of a
+// message and its fast packet state are only touched by one thread, so samples stay in order.
+// Shard 0 is decoded by the calling thread, every other shard by a worker thread of its own.
+// Decoding runs without the lock of the data map, data_map_mutex, which is only taken to create new
+// series. The samples are staged until mergeDecoded() writes them in one short locked step.
+class ShardedFrameDecoder
+{
+public:
+  ShardedFrameDecoder(const std::string& dbc_location, CanFrameProcessor::CanProtocol protocol,
+                      PJ::PlotDataMapRef& data_map, std::mutex& data_map_mutex,
+                      const std::unordered_map<std::string, QRegularExpression>& filter_list, size_t shard_count);
+  ~ShardedFrameDecoder();
+
+  size_t shardCount() const
+  {
+    return shards_.size();
+  }
+  bool isExtendedId() const
+  {
+    return shards_[0]->processor->isExtendedId();
+  }
+  // Calls func on the processor of every shard, to configure them before the first frame
+  void forEachProcessor(const std::function<void(CanFrameProcessor&)>& func);
+  // ISO-TP channels of every shard, see CanFrameProcessor::setIsoTpChannels. Both ids of a channel go
+  // to the same shard, which also sees the flow control of the transfers.
+  void setIsoTpChannels(const std::vector<CanFrameProcessor::IsoTpChannel>& channels);
+
+  // Copies the frame into the queue of its shard
+  void queueFrame(const uint32_t frame_id, const uint8_t* data_ptr, const size_t data_len, const uint8_t flags,
+                  const double timestamp_secs);
+  // Decodes the queued frames of all shards in parallel and returns once they are done. Call without
+  // holding the lock of the data map.
+  void decodeQueued();
+  // Writes the samples decoded since the last call into the data map, call with its lock held
+  void mergeDecoded();
+
+  // DBC hot reload of every shard, see CanFrameProcessor::parseDatabase. reloadDatabase may run on any
+  // thread, it builds the tables of all shards and publishes them together only if the file could be
+  // parsed. applyReloadedDatabase is called between cycles, all shards switch in the same cycle.
+  // Returns true if new tables were adopted.
+  bool reloadDatabase(const std::string& dbc_location);
+  bool applyReloadedDatabase();
+
+private:
+  struct Shard
+  {
+    std::unique_ptr<CanFrameProcessor> processor;
+    std::vector<RawFrameRecord> frames;
+    std::thread worker;
+  };
+  size_t shardIndex(const uint32_t frame_id) const;
+  void decodeShard(Shard& shard);
+  void workerLoop(Shard& shard);
+
+  CanFrameProcessor::CanProtocol protocol_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // Ids decoded in the shard of another id, the response ids of ISO-TP channels
+  std::unordered_map<uint32_t, uint32_t> shard_aliases_;
+  // Tables of a reloaded DBC for every shard, waiting to be adopted. Only accessed with the atomic
+  // shared_ptr functions.
+  using ShardTables = std::vector<std::unique_ptr<CanFrameProcessor::DecodeTables>>;
+  std::shared_ptr<ShardTables> reloaded_tables_;
+  // A cycle starts when cycle_ is incremented and ends when no worker is busy anymore
+  std::mutex cycle_mutex_;
+  std::condition_variable cycle_started_;
+  std::condition_variable cycle_done_;
+  uint64_t cycle_ = 0;
+  size_t busy_workers_ = 0;
+  bool stopping_ = false;
+};
+
+#endif  // SHARDED_FRAME_DECODER_H_
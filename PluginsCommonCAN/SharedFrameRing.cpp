@@ -0,0 +1,74 @@
+#include <QtGlobal>
+#include <QDebug>
+
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "SharedFrameRing.h"
+
+namespace
+{
+const char RING_MAGIC[8] = { 'P', 'J', 'C', 'A', 'N', 'S', 'H', 'M' };
+const uint32_t RING_VERSION = 1;
+}  // namespace
+
+SharedFrameRingReader::SharedFrameRingReader(const QString& name)
+{
+#ifdef Q_OS_WIN
+  qDebug() << "Shared memory frame rings are not supported on Windows, cannot attach to" << name;
+#else
+  // Read and write, the consumer owns read_index
+  const int fd = shm_open(name.toLocal8Bit().constData(), O_RDWR, 0);
+  if (fd < 0)
+  {
+    qDebug() << "Cannot open shared memory frame ring" << name << strerror(errno);
+    return;
+  }
+  struct stat info;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(SharedFrameRingHeader))
+  {
+    mapping = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  // The mapping stays valid without the descriptor
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+  {
+    qDebug() << "Cannot map shared memory frame ring" << name;
+    return;
+  }
+  SharedFrameRingHeader* header = static_cast<SharedFrameRingHeader*>(mapping);
+  const uint64_t capacity = header->capacity;
+  if (memcmp(header->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 || header->version != RING_VERSION ||
+      header->record_size != sizeof(RawFrameRecord) || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+      size_t(info.st_size) < sizeof(SharedFrameRingHeader) + capacity * sizeof(RawFrameRecord))
+  {
+    qDebug() << "Invalid shared memory frame ring" << name;
+    munmap(mapping, size_t(info.st_size));
+    return;
+  }
+  header_ = header;
+  records_ = reinterpret_cast<const RawFrameRecord*>(static_cast<const uint8_t*>(mapping) + sizeof(SharedFrameRingHeader));
+  capacity_ = capacity;
+  mapping_size_ = size_t(info.st_size);
+  // Frames written before attaching are skipped, a full ring would otherwise replay stale frames first
+  header_->read_index.store(header_->write_index.load(std::memory_order_acquire), std::memory_order_release);
+#endif
+}
+
+SharedFrameRingReader::~SharedFrameRingReader()
+{
+#ifndef Q_OS_WIN
+  if (header_)
+  {
+    munmap(header_, mapping_size_);
+  }
+#endif
+}
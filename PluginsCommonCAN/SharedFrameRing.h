@@ -0,0 +1,87 @@
+#ifndef SHARED_FRAME_RING_H_
+#define SHARED_FRAME_RING_H_
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+#include "RawFrameArchive.h"
+
+// Layout of a shared memory frame ring, a POSIX shared memory object (shm_open) named e.g. "/hil_can":
+//   SharedFrameRingHeader, followed by `capacity` RawFrameRecord slots, capacity a power of two.
+// There is one producer and one consumer, and the indexes count frames since the ring was created,
+// they never wrap. Frame i is in slot i % capacity.
+//   - The producer writes the record of frame i, then stores write_index = i + 1 (release).
+//   - The consumer loads write_index (acquire), reads the slots from read_index up to it in place, then
+//     stores the new read_index (release) once it is done with them.
+//   - The producer loads read_index (acquire) and never writes a slot that is not consumed yet: when
+//     write_index - read_index == capacity the ring is full, the frame is dropped and dropped_frames
+//     is incremented.
+// Records use the layout of the raw frame archive, in the byte order of the host.
+// The producer creates the object (shm_open with O_CREAT), sizes it with ftruncate, which zero fills
+// the indexes, then writes version, record_size and capacity, and the magic last, after a release
+// fence: a consumer attaching meanwhile rejects the ring.
+struct SharedFrameRingHeader
+{
+  char magic[8];  // "PJCANSHM"
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  uint8_t reserved[40];
+  // Each index has a cache line of its own, producer and consumer do not write the same line
+  alignas(64) std::atomic<uint64_t> write_index;
+  alignas(64) std::atomic<uint64_t> read_index;
+  alignas(64) std::atomic<uint64_t> dropped_frames;
+};
+static_assert(sizeof(SharedFrameRingHeader) == 256, "shared ring header layout changed");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring indexes must be lock free");
+
+// Consumer side of a shared memory frame ring, see SharedFrameRingHeader. Frames are handed out in
+// place, without copying them out of the shared memory.
+class SharedFrameRingReader
+{
+public:
+  explicit SharedFrameRingReader(const QString& name);
+  ~SharedFrameRingReader();
+
+  bool isOpen() const
+  {
+    return header_ != nullptr;
+  }
+  // Frames the producer could not write because the ring was full
+  uint64_t droppedFrames() const
+  {
+    return header_->dropped_frames.load(std::memory_order_relaxed);
+  }
+
+  // Calls func(record) for every frame written since the last call, the ring is emptied so that the
+  // producer never waits on a backlog of the consumer. The record is only valid during the call.
+  // Returns the number of frames.
+  template <typename Func>
+  size_t readAvailable(Func func)
+  {
+    const uint64_t write_index = header_->write_index.load(std::memory_order_acquire);
+    uint64_t read_index = header_->read_index.load(std::memory_order_relaxed);
+    // A producer that reset the ring in place starts over, follow it
+    if (write_index < read_index)
+    {
+      read_index = write_index;
+    }
+    for (uint64_t i = read_index; i < write_index; i++)
+    {
+      func(records_[i & (capacity_ - 1)]);
+    }
+    // Hands the slots back to the producer
+    header_->read_index.store(write_index, std::memory_order_release);
+    return size_t(write_index - read_index);
+  }
+
+private:
+  SharedFrameRingHeader* header_ = nullptr;
+  const RawFrameRecord* records_ = nullptr;
+  uint64_t capacity_ = 0;
+  size_t mapping_size_ = 0;
+};
+
+#endif  // SHARED_FRAME_RING_H_
@@ -0,0 +1,159 @@
+#include <QFile>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SpanTracer.h"
+
+std::atomic<bool> SpanTracer::enabled_{ false };
+
+namespace
+{
+struct Span
+{
+  const char* name;
+  uint64_t start_ticks;
+  uint64_t end_ticks;
+};
+
+struct ThreadSpans
+{
+  std::vector<Span> spans;
+  uint64_t count = 0;  // spans recorded since tracing was enabled, the ring keeps the last ones
+  uint64_t generation = 0;
+  uint32_t tid = 0;
+  std::string name;
+};
+
+// Threads register their ring once, the rings outlive their threads until the trace is written
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadSpans>> registry;
+// Bumped when tracing is enabled, the rings of an older generation are cleared on their next span
+std::atomic<uint64_t> generation{ 0 };
+std::atomic<uint64_t> origin_ticks{ 0 };
+std::chrono::steady_clock::time_point origin_time;
+
+thread_local std::shared_ptr<ThreadSpans> thread_spans;
+
+ThreadSpans& threadSpans()
+{
+  if (!thread_spans)
+  {
+    thread_spans = std::make_shared<ThreadSpans>();
+    thread_spans->spans.resize(SpanTracer::SPANS_PER_THREAD);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    thread_spans->tid = uint32_t(registry.size() + 1);
+    registry.push_back(thread_spans);
+  }
+  ThreadSpans& spans = *thread_spans;
+  const uint64_t current_generation = generation.load(std::memory_order_relaxed);
+  if (spans.generation != current_generation)
+  {
+    spans.generation = current_generation;
+    spans.count = 0;
+  }
+  return spans;
+}
+
+QByteArray jsonString(const std::string& text)
+{
+  QByteArray escaped = QByteArray::fromStdString(text);
+  escaped.replace('\\', "\\\\").replace('"', "\\\"");
+  return '"' + escaped + '"';
+}
+}  // namespace
+
+void SpanTracer::setEnabled(bool enabled)
+{
+  if (enabled)
+  {
+    origin_time = std::chrono::steady_clock::now();
+    origin_ticks.store(now(), std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_relaxed);
+  }
+  enabled_.store(enabled, std::memory_order_release);
+}
+
+void SpanTracer::record(const char* name, uint64_t start_ticks, uint64_t end_ticks)
+{
+  ThreadSpans& spans = threadSpans();
+  spans.spans[spans.count % SPANS_PER_THREAD] = { name, start_ticks, end_ticks };
+  spans.count++;
+}
+
+void SpanTracer::setThreadName(const char* name)
+{
+  // The ring of a thread is only allocated once tracing is enabled
+  if (!isEnabled())
+  {
+    return;
+  }
+  threadSpans().name = name;
+}
+
+bool SpanTracer::writeChromeTrace(const QString& filename, QString* error_string)
+{
+  QFile file(filename);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+  {
+    *error_string = file.errorString();
+    return false;
+  }
+  // TSC frequency from the ticks and the steady clock elapsed since tracing was enabled
+  const uint64_t origin = origin_ticks.load(std::memory_order_relaxed);
+  const double elapsed_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin_time).count();
+  const double ticks_per_us = elapsed_us > 0.0 ? double(now() - origin) / elapsed_us : 1.0;
+  const uint64_t current_generation = generation.load(std::memory_order_relaxed);
+
+  QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  auto append_event = [&](const QByteArray& event) {
+    if (!first)
+    {
+      json += ",\n";
+    }
+    first = false;
+    json += event;
+  };
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const std::shared_ptr<ThreadSpans>& spans : registry)
+  {
+    if (spans->generation != current_generation || spans->count == 0)
+    {
+      continue;
+    }
+    const QByteArray tid = QByteArray::number(spans->tid);
+    if (!spans->name.empty())
+    {
+      append_event("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":" +
+                   jsonString(spans->name) + "}}");
+    }
+    const uint64_t kept = std::min<uint64_t>(spans->count, SPANS_PER_THREAD);
+    for (uint64_t i = spans->count - kept; i < spans->count; i++)
+    {
+      const Span& span = spans->spans[i % SPANS_PER_THREAD];
+      // Spans started before tracing was enabled
+      if (span.start_ticks < origin)
+      {
+        continue;
+      }
+      const double ts = double(span.start_ticks - origin) / ticks_per_us;
+      const double dur = double(span.end_ticks - span.start_ticks) / ticks_per_us;
+      append_event("{\"name\":" + jsonString(span.name) + ",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+                   ",\"ts\":" + QByteArray::number(ts, 'f', 3) + ",\"dur\":" + QByteArray::number(dur, 'f', 3) +
+                   "}");
+    }
+  }
+  json += "\n]}\n";
+  if (file.write(json) != json.size())
+  {
+    *error_string = file.errorString();
+    return false;
+  }
+  return true;
+}
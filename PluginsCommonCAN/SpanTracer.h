@@ -0,0 +1,79 @@
+#ifndef SPAN_TRACER_H_
+#define SPAN_TRACER_H_
+
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timed spans of the streaming pipeline (read, lock, decode, emission, ...), recorded per thread and
+// written as a Chrome trace, which chrome://tracing and ui.perfetto.dev open. Every thread records
+// into a ring of its own, without locking, the oldest spans are overwritten. Timestamps are TSC ticks
+// where available, converted to microseconds when the trace is written. While disabled a span costs a
+// relaxed load and a branch.
+class SpanTracer
+{
+public:
+  static constexpr size_t SPANS_PER_THREAD = 1 << 16;
+
+  // Enabling clears the spans recorded so far
+  static void setEnabled(bool enabled);
+  static bool isEnabled()
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+  static uint64_t now()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+  static void record(const char* name, uint64_t start_ticks, uint64_t end_ticks);
+  // Name of the calling thread in the trace, set after enabling
+  static void setThreadName(const char* name);
+
+  // Writes the spans of all threads. The threads must not record meanwhile, write the trace once the
+  // streaming has stopped.
+  static bool writeChromeTrace(const QString& filename, QString* error_string);
+
+private:
+  static std::atomic<bool> enabled_;
+};
+
+// Span from construction to end() or destruction. name must be a string literal.
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char* name) : name_{ name }, start_ticks_{ SpanTracer::isEnabled() ? SpanTracer::now() : 0 }
+  {
+  }
+  ~TraceSpan()
+  {
+    end();
+  }
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  void end()
+  {
+    if (start_ticks_ != 0)
+    {
+      SpanTracer::record(name_, start_ticks_, SpanTracer::now());
+      start_ticks_ = 0;
+    }
+  }
+
+private:
+  const char* name_;
+  uint64_t start_ticks_;
+};
+
+#endif  // SPAN_TRACER_H_
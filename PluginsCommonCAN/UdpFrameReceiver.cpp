@@ -0,0 +1,415 @@
+#include <QtGlobal>
+#include <QDebug>
+
+#ifndef Q_OS_WIN
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "UdpFrameReceiver.h"
+
+namespace
+{
+const uint8_t CANNELLONI_VERSION = 2;
+const uint8_t CANNELLONI_OP_DATA = 0;
+const size_t CANNELLONI_HEADER_SIZE = 5;
+const uint8_t CANNELLONI_FD_FRAME = 0x80;
+const uint8_t CANFD_BRS = 0x01;
+
+// Flags and masks of the Linux can_id, as sent by cannelloni
+const uint32_t CAN_EFF_FLAG = 0x80000000;
+const uint32_t CAN_RTR_FLAG = 0x40000000;
+const uint32_t CAN_ERR_FLAG = 0x20000000;
+const uint32_t CAN_EFF_MASK = 0x1FFFFFFF;
+const uint32_t CAN_SFF_MASK = 0x000007FF;
+
+// Datagrams are never larger than a jumbo frame
+const size_t MAX_DATAGRAM_SIZE = 9216;
+// A burst of this many datagrams with old sequence numbers means the sender restarted
+const int MAX_CONSECUTIVE_LATE = 16;
+// Datagrams arriving between two reads wait in the socket
+const int RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+const uint8_t CANFD_DLC_LENGTHS[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+double wallClockSecs()
+{
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool parseHex(const uint8_t* text, size_t digits, uint32_t& value)
+{
+  value = 0;
+  for (size_t i = 0; i < digits; i++)
+  {
+    const uint8_t c = text[i];
+    uint32_t nibble;
+    if (c >= '0' && c <= '9')
+    {
+      nibble = c - '0';
+    }
+    else if (c >= 'a' && c <= 'f')
+    {
+      nibble = c - 'a' + 10;
+    }
+    else if (c >= 'A' && c <= 'F')
+    {
+      nibble = c - 'A' + 10;
+    }
+    else
+    {
+      return false;
+    }
+    value = (value << 4) | nibble;
+  }
+  return true;
+}
+}  // namespace
+
+UdpFrameReceiver::UdpFrameReceiver(const QString& address, uint16_t port)
+{
+#ifdef Q_OS_WIN
+  qDebug() << "Receiving CAN frames over UDP is not supported on Windows";
+#else
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_PASSIVE | AI_NUMERICHOST | AI_NUMERICSERV;
+  addrinfo* result = nullptr;
+  const QByteArray host = address.toLocal8Bit();
+  if (getaddrinfo(address.isEmpty() ? nullptr : host.constData(), std::to_string(port).c_str(), &hints, &result) != 0)
+  {
+    qDebug() << "Invalid address to receive CAN frames on" << address;
+    return;
+  }
+  socket_ = ::socket(result->ai_family, SOCK_DGRAM, 0);
+  if (socket_ >= 0)
+  {
+    // The default buffer overflows on busy buses within a cycle
+    setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &RECEIVE_BUFFER_SIZE, sizeof(RECEIVE_BUFFER_SIZE));
+#ifdef Q_OS_LINUX
+    const int enable = 1;
+    setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+#endif
+    if (bind(socket_, result->ai_addr, result->ai_addrlen) != 0)
+    {
+      qDebug() << "Cannot receive CAN frames on port" << port << strerror(errno);
+      ::close(socket_);
+      socket_ = -1;
+    }
+  }
+  freeaddrinfo(result);
+#endif
+}
+
+UdpFrameReceiver::~UdpFrameReceiver()
+{
+#ifndef Q_OS_WIN
+  if (socket_ >= 0)
+  {
+    ::close(socket_);
+  }
+#endif
+}
+
+void UdpFrameReceiver::receive()
+{
+#ifdef Q_OS_LINUX
+  // One system call returns a batch of datagrams, each with the time the kernel received it
+  const unsigned BATCH_SIZE = 64;
+  buffer_.resize(BATCH_SIZE * MAX_DATAGRAM_SIZE);
+  mmsghdr messages[BATCH_SIZE];
+  iovec vectors[BATCH_SIZE];
+  // Control buffers aligned for the cmsghdr read from them, as in cmsg(3)
+  union ControlBuffer
+  {
+    char buf[CMSG_SPACE(sizeof(timespec))];
+    cmsghdr align;
+  };
+  ControlBuffer controls[BATCH_SIZE];
+  // The socket is emptied, a backlog left in its buffer would overflow it and lose datagrams unseen
+  for (;;)
+  {
+    for (unsigned i = 0; i < BATCH_SIZE; i++)
+    {
+      vectors[i].iov_base = buffer_.data() + i * MAX_DATAGRAM_SIZE;
+      vectors[i].iov_len = MAX_DATAGRAM_SIZE;
+      messages[i].msg_hdr = {};
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+      messages[i].msg_hdr.msg_control = controls[i].buf;
+      messages[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+    }
+    const int count = recvmmsg(socket_, messages, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+    if (count <= 0)
+    {
+      break;
+    }
+    for (int i = 0; i < count; i++)
+    {
+      double timestamp = 0.0;
+      for (cmsghdr* cmsg = CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&messages[i].msg_hdr, cmsg))
+      {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+        {
+          timespec time;
+          memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+          timestamp = time.tv_sec + time.tv_nsec * 1e-9;
+        }
+      }
+      if (messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+      {
+        counters_.datagrams++;
+        counters_.invalid_datagrams++;
+        continue;
+      }
+      addDatagram(static_cast<const uint8_t*>(vectors[i].iov_base), messages[i].msg_len,
+                  timestamp > 0.0 ? timestamp : wallClockSecs());
+    }
+    if (unsigned(count) < BATCH_SIZE)
+    {
+      break;
+    }
+  }
+#elif !defined(Q_OS_WIN)
+  buffer_.resize(MAX_DATAGRAM_SIZE);
+  for (;;)
+  {
+    const ssize_t size = recv(socket_, buffer_.data(), buffer_.size(), MSG_DONTWAIT);
+    if (size < 0)
+    {
+      break;
+    }
+    addDatagram(buffer_.data(), size_t(size), wallClockSecs());
+  }
+#endif
+  releaseInOrder();
+}
+
+void UdpFrameReceiver::addDatagram(const uint8_t* data, size_t size, double timestamp_secs)
+{
+  counters_.datagrams++;
+  if (size > 0 && data[0] == CANNELLONI_VERSION)
+  {
+    if (size < CANNELLONI_HEADER_SIZE || data[1] != CANNELLONI_OP_DATA)
+    {
+      counters_.invalid_datagrams++;
+      return;
+    }
+    held_.push_back({ timestamp_secs, data[2], arrivals_++, 0, std::vector<uint8_t>(data, data + size) });
+  }
+  else if (!parseSlcan(data, size, timestamp_secs))
+  {
+    counters_.invalid_datagrams++;
+  }
+}
+
+void UdpFrameReceiver::releaseInOrder()
+{
+  if (held_.empty())
+  {
+    return;
+  }
+  if (!has_expected_)
+  {
+    has_expected_ = true;
+    expected_sequence_ = held_.front().sequence;
+  }
+  // Sequence numbers wrap at 256, the lower half of the distances is ahead of the expected one
+  auto distance = [this](const Datagram& datagram) { return uint8_t(datagram.sequence - expected_sequence_); };
+  std::stable_sort(held_.begin(), held_.end(),
+                   [&](const Datagram& a, const Datagram& b) { return distance(a) < distance(b); });
+  // Once a datagram has waited for a read, the missing ones are given up on
+  const bool waited = std::any_of(held_.begin(), held_.end(), [](const Datagram& datagram) { return datagram.held_reads > 0; });
+
+  size_t released = 0;
+  for (; released < held_.size(); released++)
+  {
+    const Datagram& datagram = held_[released];
+    const uint8_t gap = distance(datagram);
+    if (gap >= 128)
+    {
+      // Behind the expected sequence: a duplicate, or a datagram whose gap was already skipped
+      counters_.late_datagrams++;
+      if (++consecutive_late_ > MAX_CONSECUTIVE_LATE)
+      {
+        has_expected_ = false;
+        consecutive_late_ = 0;
+      }
+      continue;
+    }
+    if (gap > 0 && !waited)
+    {
+      break;
+    }
+    counters_.lost_datagrams += gap;
+    consecutive_late_ = 0;
+    if (datagram.arrival < last_released_arrival_)
+    {
+      counters_.reordered_datagrams++;
+    }
+    last_released_arrival_ = std::max(last_released_arrival_, datagram.arrival);
+    if (!parseCannelloni(datagram.payload.data(), datagram.payload.size(), datagram.timestamp_secs))
+    {
+      counters_.invalid_datagrams++;
+    }
+    expected_sequence_ = uint8_t(datagram.sequence + 1);
+  }
+  held_.erase(held_.begin(), held_.begin() + released);
+  for (Datagram& datagram : held_)
+  {
+    datagram.held_reads++;
+  }
+}
+
+bool UdpFrameReceiver::parseCannelloni(const uint8_t* data, size_t size, double timestamp_secs)
+{
+  timestamp_secs = std::max(timestamp_secs, last_timestamp_);
+  last_timestamp_ = timestamp_secs;
+  const size_t count = size_t(data[3]) << 8 | data[4];
+  size_t pos = CANNELLONI_HEADER_SIZE;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (pos + 5 > size)
+    {
+      return false;
+    }
+    const uint32_t can_id = uint32_t(data[pos]) << 24 | uint32_t(data[pos + 1]) << 16 | uint32_t(data[pos + 2]) << 8 | data[pos + 3];
+    uint8_t len = data[pos + 4];
+    pos += 5;
+    RawFrameRecord& record = frames_.emplace_back();
+    record.timestamp_secs = timestamp_secs;
+    record.flags = 0;
+    record.reserved = 0;
+    if (len & CANNELLONI_FD_FRAME)
+    {
+      if (pos >= size)
+      {
+        frames_.pop_back();
+        return false;
+      }
+      record.flags |= RawFrameRecord::FLEXIBLE_DATA_RATE;
+      record.flags |= (data[pos++] & CANFD_BRS) ? RawFrameRecord::BITRATE_SWITCH : 0;
+      len &= ~CANNELLONI_FD_FRAME;
+    }
+    // The payload of a remote request is not sent, its length is the requested one
+    const size_t payload_len = (can_id & CAN_RTR_FLAG) ? 0 : len;
+    if (len > sizeof(record.data) || pos + payload_len > size)
+    {
+      frames_.pop_back();
+      return false;
+    }
+    record.flags |= (can_id & CAN_EFF_FLAG) ? RawFrameRecord::EXTENDED_ID : 0;
+    record.flags |= (can_id & CAN_RTR_FLAG) ? RawFrameRecord::REMOTE_REQUEST : 0;
+    record.flags |= (can_id & CAN_ERR_FLAG) ? RawFrameRecord::ERROR_FRAME : 0;
+    record.frame_id = can_id & ((can_id & (CAN_EFF_FLAG | CAN_ERR_FLAG)) ? CAN_EFF_MASK : CAN_SFF_MASK);
+    record.data_len = uint8_t(payload_len);
+    memcpy(record.data, data + pos, payload_len);
+    pos += payload_len;
+    counters_.frames++;
+  }
+  return true;
+}
+
+bool UdpFrameReceiver::parseSlcan(const uint8_t* data, size_t size, double timestamp_secs)
+{
+  timestamp_secs = std::max(timestamp_secs, last_timestamp_);
+  last_timestamp_ = timestamp_secs;
+  bool valid = size > 0;
+  for (size_t start = 0; start < size;)
+  {
+    size_t end = start;
+    while (end < size && data[end] != '\r' && data[end] != '\n')
+    {
+      end++;
+    }
+    const uint8_t* line = data + start;
+    const size_t line_len = end - start;
+    start = end + 1;
+    if (line_len == 0)
+    {
+      continue;
+    }
+
+    bool extended = false;
+    bool remote = false;
+    bool fd = false;
+    bool brs = false;
+    switch (line[0])
+    {
+      case 't':
+        break;
+      case 'T':
+        extended = true;
+        break;
+      case 'r':
+        remote = true;
+        break;
+      case 'R':
+        extended = remote = true;
+        break;
+      case 'd':
+        fd = true;
+        break;
+      case 'D':
+        extended = fd = true;
+        break;
+      case 'b':
+        fd = brs = true;
+        break;
+      case 'B':
+        extended = fd = brs = true;
+        break;
+      default:
+        // Acknowledgements and status replies carry no frame
+        continue;
+    }
+    const size_t id_digits = extended ? 8 : 3;
+    uint32_t frame_id;
+    uint32_t dlc;
+    if (line_len < 1 + id_digits + 1 || !parseHex(line + 1, id_digits, frame_id) ||
+        !parseHex(line + 1 + id_digits, 1, dlc) || (!fd && dlc > 8))
+    {
+      valid = false;
+      continue;
+    }
+    const size_t len = fd ? CANFD_DLC_LENGTHS[dlc] : dlc;
+    const uint8_t* payload = line + 2 + id_digits;
+    // A 4 digit timestamp may follow the payload, it is not used
+    if (!remote && line_len < 2 + id_digits + 2 * len)
+    {
+      valid = false;
+      continue;
+    }
+    RawFrameRecord record = {};
+    record.timestamp_secs = timestamp_secs;
+    record.frame_id = frame_id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+    record.flags |= extended ? RawFrameRecord::EXTENDED_ID : 0;
+    record.flags |= remote ? RawFrameRecord::REMOTE_REQUEST : 0;
+    record.flags |= fd ? RawFrameRecord::FLEXIBLE_DATA_RATE : 0;
+    record.flags |= brs ? RawFrameRecord::BITRATE_SWITCH : 0;
+    bool payload_valid = true;
+    for (size_t i = 0; !remote && i < len && payload_valid; i++)
+    {
+      uint32_t byte;
+      payload_valid = parseHex(payload + 2 * i, 2, byte);
+      record.data[i] = uint8_t(byte);
+    }
+    if (!payload_valid)
+    {
+      valid = false;
+      continue;
+    }
+    record.data_len = remote ? 0 : uint8_t(len);
+    frames_.push_back(record);
+    counters_.frames++;
+  }
+  return valid;
+}
@@ -0,0 +1,95 @@
+#ifndef UDP_FRAME_RECEIVER_H_
+#define UDP_FRAME_RECEIVER_H_
+
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+#include "RawFrameArchive.h"
+
+// Receives CAN frames sent over UDP by a remote logger, without a bridge to a virtual CAN interface.
+// Two datagram formats are accepted, told apart by their first byte:
+//   - cannelloni (version 2): a 5 byte header (version, op code, sequence number, big endian frame
+//     count) followed by the frames, each a big endian Linux can_id, a length byte (0x80 set for CAN
+//     FD, followed by a flags byte) and the payload, absent for remote requests.
+//   - SLCAN over UDP: ASCII commands t, T, r, R (and d, D, b, B for CAN FD) separated by '\r'.
+// Cannelloni sequence numbers are used to restore the order of datagrams swapped by the network.
+// A datagram arriving ahead of a missing one is held for one read, then the missing ones are counted
+// as lost. Frames are timestamped with the time the kernel received their datagram.
+class UdpFrameReceiver
+{
+public:
+  static const uint16_t DEFAULT_PORT = 20000;  // cannelloni default
+
+  struct Counters
+  {
+    uint64_t datagrams = 0;
+    uint64_t frames = 0;
+    uint64_t lost_datagrams = 0;
+    uint64_t reordered_datagrams = 0;
+    // Too late to be reordered, or duplicated
+    uint64_t late_datagrams = 0;
+    uint64_t invalid_datagrams = 0;
+  };
+
+  // An empty address binds to every interface
+  UdpFrameReceiver(const QString& address, uint16_t port);
+  ~UdpFrameReceiver();
+
+  bool isOpen() const
+  {
+    return socket_ >= 0;
+  }
+  const Counters& counters() const
+  {
+    return counters_;
+  }
+
+  // Calls func(record) for every frame received since the last call, in sequence order. Reads every
+  // pending datagram. Returns the number of frames.
+  template <typename Func>
+  size_t readAvailable(Func func)
+  {
+    frames_.clear();
+    receive();
+    for (const RawFrameRecord& record : frames_)
+    {
+      func(record);
+    }
+    return frames_.size();
+  }
+
+private:
+  struct Datagram
+  {
+    double timestamp_secs;
+    uint8_t sequence;
+    uint64_t arrival;
+    // Reads the datagram has waited for a missing predecessor
+    int held_reads;
+    std::vector<uint8_t> payload;
+  };
+  // Reads the pending datagrams into frames_, with recvmmsg where available
+  void receive();
+  void addDatagram(const uint8_t* data, size_t size, double timestamp_secs);
+  // Hands the held cannelloni datagrams to parseCannelloni in sequence order
+  void releaseInOrder();
+  bool parseCannelloni(const uint8_t* data, size_t size, double timestamp_secs);
+  bool parseSlcan(const uint8_t* data, size_t size, double timestamp_secs);
+
+  int socket_ = -1;
+  Counters counters_;
+  std::vector<uint8_t> buffer_;
+  std::vector<RawFrameRecord> frames_;
+  std::vector<Datagram> held_;
+  uint64_t arrivals_ = 0;
+  uint64_t last_released_arrival_ = 0;
+  bool has_expected_ = false;
+  uint8_t expected_sequence_ = 0;
+  int consecutive_late_ = 0;
+  // Reordered datagrams get the time of the one they were held behind, timestamps never go back
+  double last_timestamp_ = 0.0;
+};
+
+#endif  // UDP_FRAME_RECEIVER_H_
@@ -1,4 +1,7 @@
 #include <QFileDialog>
+#include <QDoubleValidator>
+#include <QIntValidator>
+#include <QLocale>
 
 #include "select_can_database.h"
 #include "ui_select_can_database.h"
@@ -16,6 +19,14 @@ DialogSelectCanDatabase::DialogSelectCanDatabase(QWidget* parent)
   m_ui->protocolListBox->addItem(tr("J1939"), QVariant(true));
   m_ui->protocolListBox->setCurrentIndex(0);
   m_ui->okButton->setEnabled(false);
+  m_ui->deadbandEdit->setValidator(new QDoubleValidator(0.0, 1e12, 6, this));
+  m_ui->windowStartEdit->setValidator(new QDoubleValidator(0.0, 1e12, 6, this));
+  m_ui->windowEndEdit->setValidator(new QDoubleValidator(0.0, 1e12, 6, this));
+  m_ui->bitrateEdit->setValidator(new QDoubleValidator(0.0, 1e6, 3, this));
+  m_ui->dataBitrateEdit->setValidator(new QDoubleValidator(0.0, 1e6, 3, this));
+  m_ui->retentionWindowEdit->setValidator(new QDoubleValidator(0.0, 1e12, 6, this));
+  m_ui->retentionSamplesEdit->setValidator(new QIntValidator(0, 1000000000, this));
+  m_ui->decimationEdit->setValidator(new QIntValidator(0, 10000, this));
 
   //m_ui->idFilterEdit->hide();
   //m_ui->nameFilterEdit->hide();
@@ -23,6 +34,9 @@ DialogSelectCanDatabase::DialogSelectCanDatabase(QWidget* parent)
   connect(m_ui->okButton, &QPushButton::clicked, this, &DialogSelectCanDatabase::Ok);
   connect(m_ui->cancelButton, &QPushButton::clicked, this, &DialogSelectCanDatabase::Cancel);
   connect(m_ui->loadDatabaseButton, &QPushButton::clicked, this, &DialogSelectCanDatabase::ImportDatabaseLocation);
+  connect(m_ui->changeOnlyBox, &QCheckBox::toggled, m_ui->deadbandEdit, &QLineEdit::setEnabled);
+  connect(m_ui->busLoadBox, &QCheckBox::toggled, m_ui->bitrateEdit, &QLineEdit::setEnabled);
+  connect(m_ui->busLoadBox, &QCheckBox::toggled, m_ui->dataBitrateEdit, &QLineEdit::setEnabled);
 }
 QString DialogSelectCanDatabase::GetDatabaseLocation() const
 {
@@ -33,6 +47,34 @@ CanFrameProcessor::CanProtocol DialogSelectCanDatabase::GetCanProtocol() const
   return m_protocol;
 }
 
+void DialogSelectCanDatabase::setLogDuration(double duration_secs)
+{
+  m_ui->windowEndEdit->setPlaceholderText(tr("end (%1)").arg(duration_secs, 0, 'f', 1));
+}
+
+void DialogSelectCanDatabase::setFileLoadOptionsAvailable(bool available)
+{
+  m_ui->timeWindowLabel->setVisible(available);
+  m_ui->windowStartEdit->setVisible(available);
+  m_ui->windowEndEdit->setVisible(available);
+  m_ui->lazyDecodeLabel->setVisible(available);
+  m_ui->lazyDecodeBox->setVisible(available);
+  m_ui->bitrateLabel->setVisible(available);
+  m_ui->bitrateEdit->setVisible(available);
+  m_ui->dataBitrateEdit->setVisible(available);
+  m_ui->retentionLabel->setVisible(available);
+  m_ui->retentionWindowEdit->setVisible(available);
+  m_ui->retentionSamplesEdit->setVisible(available);
+  m_ui->decimationEdit->setVisible(available);
+}
+
+void DialogSelectCanDatabase::setSignalPatterns(const std::vector<std::string>& include,
+                                                const std::vector<std::string>& exclude)
+{
+  m_ui->signalIncludeEdit->setText(QString::fromStdString(NameMatcher::joinPatterns(include)));
+  m_ui->signalExcludeEdit->setText(QString::fromStdString(NameMatcher::joinPatterns(exclude)));
+}
+
 DialogSelectCanDatabase::~DialogSelectCanDatabase()
 {
   delete m_ui;
@@ -101,6 +143,32 @@ void DialogSelectCanDatabase::updateConfig()
       qDebug() << k;
     }
   }
+  // update storage mode
+  m_change_only = m_ui->changeOnlyBox->isChecked();
+  // The validator accepts the decimal separator of the locale, which QString::toDouble() rejects
+  m_deadband = QLocale().toDouble(m_ui->deadbandEdit->text());
+  m_lazy_decode = !m_ui->lazyDecodeBox->isHidden() && m_ui->lazyDecodeBox->isChecked();
+  m_statistics = m_ui->statisticsBox->isChecked();
+  // update bus load, bitrates are entered in kbit/s
+  m_bus_load = m_ui->busLoadBox->isChecked();
+  if (!m_ui->bitrateEdit->text().isEmpty())
+  {
+    m_bitrate = uint32_t(QLocale().toDouble(m_ui->bitrateEdit->text()) * 1000);
+  }
+  m_data_bitrate = uint32_t(QLocale().toDouble(m_ui->dataBitrateEdit->text()) * 1000);
+  // update signal selection
+  m_signal_include = NameMatcher::splitPatterns(m_ui->signalIncludeEdit->text().toStdString());
+  m_signal_exclude = NameMatcher::splitPatterns(m_ui->signalExcludeEdit->text().toStdString());
+  // update ISO-TP channels
+  m_isotp_channels = CanFrameProcessor::parseIsoTpChannels(m_ui->isoTpEdit->text());
+  // update retention, empty fields disable a limit
+  m_retention.window_secs = QLocale().toDouble(m_ui->retentionWindowEdit->text());
+  m_retention.max_samples = QLocale().toUInt(m_ui->retentionSamplesEdit->text());
+  m_retention.decimation_factor = QLocale().toUInt(m_ui->decimationEdit->text());
+  // update time window
+  m_window_start = QLocale().toDouble(m_ui->windowStartEdit->text());
+  m_window_end = m_ui->windowEndEdit->text().isEmpty() ? std::numeric_limits<double>::infinity()
+                                                       : QLocale().toDouble(m_ui->windowEndEdit->text());
 }
 void DialogSelectCanDatabase::ImportDatabaseLocation()
 {
@@ -8,6 +8,7 @@
 #include <QCheckBox>
 #include <QShortcut>
 #include <QDomDocument>
+#include <limits>
 #include "../PluginsCommonCAN/CanFrameProcessor.h"
 
 QT_BEGIN_NAMESPACE
@@ -28,6 +29,30 @@ public:
   CanFrameProcessor::CanProtocol GetCanProtocol() const;
   const std::unordered_map<std::string, QRegularExpression>& getNameFilterList() const {return m_filter_list;};
   const std::unordered_set<uint64_t>& getIdFilterList() const { return m_id_filter_list;};
+  bool isChangeOnlyEnabled() const { return m_change_only;};
+  double getDeadband() const { return m_deadband;};
+  bool isLazyDecodeEnabled() const { return m_lazy_decode;};
+  bool isStatisticsEnabled() const { return m_statistics;};
+  bool isBusLoadEnabled() const { return m_bus_load;};
+  // Bitrates of the logged bus in bit/s, streamers take them from the connection instead
+  uint32_t getBitrate() const { return m_bitrate;};
+  uint32_t getDataBitrate() const { return m_data_bitrate;};
+  // Include and exclude patterns on Message/Signal paths
+  const std::vector<std::string>& getSignalIncludePatterns() const { return m_signal_include;};
+  const std::vector<std::string>& getSignalExcludePatterns() const { return m_signal_exclude;};
+  // Request/response id pairs reassembled as ISO-TP in RAW mode
+  const std::vector<CanFrameProcessor::IsoTpChannel>& getIsoTpChannels() const { return m_isotp_channels;};
+  // Prefill the signal patterns, e.g. from a saved layout
+  void setSignalPatterns(const std::vector<std::string>& include, const std::vector<std::string>& exclude);
+  // Retention of every series, see CanFrameProcessor::setRetentionPolicy
+  const CanFrameProcessor::RetentionPolicy& getRetentionPolicy() const { return m_retention;};
+  // Time window relative to the start of the log, the whole log when not set
+  double getTimeWindowStart() const { return m_window_start;};
+  double getTimeWindowEnd() const { return m_window_end;};
+  // Show the length of the log as a hint for the time window
+  void setLogDuration(double duration_secs);
+  // Time window, lazy decoding, the bitrate and the retention only apply to file loads, streamers hide them
+  void setFileLoadOptionsAvailable(bool available);
 
   ~DialogSelectCanDatabase() override;
 
@@ -41,6 +66,19 @@ private:
   CanFrameProcessor::CanProtocol m_protocol;
   std::unordered_map<std::string, QRegularExpression> m_filter_list;
   std::unordered_set<uint64_t> m_id_filter_list;
+  bool m_change_only = false;
+  double m_deadband = 0.0;
+  bool m_lazy_decode = false;
+  bool m_statistics = false;
+  bool m_bus_load = false;
+  uint32_t m_bitrate = 500000;
+  uint32_t m_data_bitrate = 0;
+  std::vector<std::string> m_signal_include;
+  std::vector<std::string> m_signal_exclude;
+  std::vector<CanFrameProcessor::IsoTpChannel> m_isotp_channels;
+  CanFrameProcessor::RetentionPolicy m_retention;
+  double m_window_start = 0.0;
+  double m_window_end = std::numeric_limits<double>::infinity();
 
   // update configuration
   void updateConfig();